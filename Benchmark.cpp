@@ -0,0 +1,118 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace gps {
+
+    static double Percentile(const std::vector<double>& sorted, double fraction) {
+
+        return sorted[std::min((size_t)(sorted.size() * fraction), sorted.size() - 1)];
+    }
+
+    static std::string QuoteJson(const std::string& text) {
+
+        std::string quoted = "\"";
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '"' || text[i] == '\\') {
+                quoted += '\\';
+            }
+            quoted += text[i];
+        }
+        return quoted + "\"";
+    }
+
+    void Benchmark::Create(int warmupFrames, int frames) {
+
+        this->warmupFrames = std::max(warmupFrames, 0);
+        this->frames = std::max(frames, 1);
+        framesEnded = 0;
+        frameTimes.clear();
+        frameTimes.reserve(this->frames);
+        lastFrame = Clock::now();
+    }
+
+    void Benchmark::EndFrame() {
+
+        Clock::time_point now = Clock::now();
+        if (!IsWarmingUp() && !IsFinished()) {
+            frameTimes.push_back(std::chrono::duration<double, std::milli>(now - lastFrame).count());
+        }
+        lastFrame = now;
+        framesEnded++;
+    }
+
+    bool Benchmark::IsWarmingUp() const {
+
+        return framesEnded < warmupFrames;
+    }
+
+    bool Benchmark::IsFinished() const {
+
+        return framesEnded >= warmupFrames + frames;
+    }
+
+    void Benchmark::SetParameter(const std::string& name, const std::string& value) {
+
+        parameters.push_back(std::make_pair(name, QuoteJson(value)));
+    }
+
+    void Benchmark::SetParameter(const std::string& name, double value) {
+
+        std::ostringstream text;
+        text << value;
+        parameters.push_back(std::make_pair(name, text.str()));
+    }
+
+    void Benchmark::SetFlag(const std::string& name, bool value) {
+
+        parameters.push_back(std::make_pair(name, std::string(value ? "true" : "false")));
+    }
+
+    BenchmarkStats Benchmark::GetStats() const {
+
+        BenchmarkStats stats = { (int)frameTimes.size(), 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        if (frameTimes.empty()) {
+            return stats;
+        }
+
+        std::vector<double> sorted = frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (size_t i = 0; i < sorted.size(); i++) {
+            sum += sorted[i];
+        }
+        stats.average = sum / sorted.size();
+        stats.p50 = Percentile(sorted, 0.50);
+        stats.p95 = Percentile(sorted, 0.95);
+        stats.p99 = Percentile(sorted, 0.99);
+        stats.max = sorted.back();
+        stats.fps = sum > 0.0 ? sorted.size() * 1000.0 / sum : 0.0;
+        return stats;
+    }
+
+    bool Benchmark::WriteReport(const std::string& path) const {
+
+        std::ofstream file(path.c_str());
+        if (!file) {
+            return false;
+        }
+
+        BenchmarkStats stats = GetStats();
+        file.setf(std::ios::fixed);
+        file.precision(3);
+        file << "{\n  \"parameters\": {\n";
+        for (size_t i = 0; i < parameters.size(); i++) {
+            file << "    " << QuoteJson(parameters[i].first) << ": " << parameters[i].second
+                << (i + 1 < parameters.size() ? "," : "") << "\n";
+        }
+        file << "  },\n"
+            << "  \"warmup_frames\": " << warmupFrames << ",\n"
+            << "  \"frames\": " << stats.frames << ",\n"
+            << "  \"frame_time_ms\": { \"avg\": " << stats.average << ", \"p50\": " << stats.p50
+            << ", \"p95\": " << stats.p95 << ", \"p99\": " << stats.p99 << ", \"max\": " << stats.max << " },\n"
+            << "  \"fps\": " << stats.fps << "\n}\n";
+        return (bool)file;
+    }
+}
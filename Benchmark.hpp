@@ -0,0 +1,58 @@
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gps {
+
+    // over the measured frames, in milliseconds
+    struct BenchmarkStats {
+        int frames;
+        double average;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+        // frames per second over the whole measurement
+        double fps;
+    };
+
+    // Frame times of a fixed number of frames after a warm-up, reported as a JSON object
+    // together with the settings of the run, so runs of different builds can be compared.
+    class Benchmark {
+
+    public:
+        // the first interval is measured from here
+        void Create(int warmupFrames, int frames);
+
+        // once per frame, after the swap and the frame limiter
+        void EndFrame();
+
+        bool IsWarmingUp() const;
+        bool IsFinished() const;
+
+        // copied into the report as they are, in the order they were set
+        void SetParameter(const std::string& name, const std::string& value);
+        void SetParameter(const std::string& name, double value);
+        void SetFlag(const std::string& name, bool value);
+
+        BenchmarkStats GetStats() const;
+        bool WriteReport(const std::string& path) const;
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        int warmupFrames;
+        int frames;
+        int framesEnded;
+        Clock::time_point lastFrame;
+        std::vector<double> frameTimes;
+        // name and JSON value
+        std::vector<std::pair<std::string, std::string> > parameters;
+    };
+}
+
+#endif /* Benchmark_hpp */
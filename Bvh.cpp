@@ -0,0 +1,592 @@
+#include "Bvh.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+namespace gps {
+
+    static const int SAH_BINS = 12;
+    static const int MAX_LEAF_TRIANGLES = 4;
+    static const int STACK_SIZE = 64;
+    // a node popped at depth d leaves at most d siblings on the stack and pushes two children,
+    // so trees no deeper than this never overflow the traversal stack
+    static const int MAX_DEPTH = STACK_SIZE - 1;
+
+    // slab test; the bounds are inflated by inflate for sphere casts. Written on whole vec3s
+    // without branches, which leaves the compiler free to vectorize it.
+    static bool IntersectBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax, float inflate,
+        const glm::vec3& origin, const glm::vec3& inverseDirection, float maxT, float& tEntry) {
+
+        glm::vec3 t1 = (boundsMin - glm::vec3(inflate) - origin) * inverseDirection;
+        glm::vec3 t2 = (boundsMax + glm::vec3(inflate) - origin) * inverseDirection;
+        glm::vec3 tNear = glm::min(t1, t2);
+        glm::vec3 tFar = glm::max(t1, t2);
+
+        tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxT));
+        return tEntry <= tExit;
+    }
+
+    static glm::vec3 InverseDirection(const glm::vec3& direction) {
+
+        // a zero component becomes a huge value instead of inf, keeping 0 * inf out of the slab test
+        glm::vec3 inverse;
+        for (int i = 0; i < 3; i++) {
+            inverse[i] = 1.0f / (std::fabs(direction[i]) > 1e-12f ? direction[i] : 1e-12f);
+        }
+        return inverse;
+    }
+
+    static float SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+
+        glm::vec3 extent = boundsMax - boundsMin;
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    // --- primitive tests ---
+
+    // Moller-Trumbore, both faces
+    static bool RayTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& v0,
+        const glm::vec3& e1, const glm::vec3& e2, float maxT, float& t) {
+
+        glm::vec3 p = glm::cross(direction, e2);
+        float determinant = glm::dot(e1, p);
+        if (std::fabs(determinant) < 1e-12f) {
+            return false;
+        }
+        float inverseDeterminant = 1.0f / determinant;
+
+        glm::vec3 s = origin - v0;
+        float u = glm::dot(s, p) * inverseDeterminant;
+        if (u < 0.0f || u > 1.0f) {
+            return false;
+        }
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(direction, q) * inverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f) {
+            return false;
+        }
+        t = glm::dot(e2, q) * inverseDeterminant;
+        return t >= 0.0f && t <= maxT;
+    }
+
+    static bool PointInTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& normal) {
+
+        return glm::dot(glm::cross(b - a, p - a), normal) >= 0.0f
+            && glm::dot(glm::cross(c - b, p - b), normal) >= 0.0f
+            && glm::dot(glm::cross(a - c, p - c), normal) >= 0.0f;
+    }
+
+    // moving sphere against a resting one of the same radius around center
+    static bool RaySphere(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& center, float radius, float& t) {
+
+        glm::vec3 m = origin - center;
+        float a = glm::dot(direction, direction);
+        float b = glm::dot(m, direction);
+        float c = glm::dot(m, m) - radius * radius;
+        if (c <= 0.0f) {
+            // already touching: a contact only when moving further in
+            t = 0.0f;
+            return b < 0.0f;
+        }
+        float discriminant = b * b - a * c;
+        if (b > 0.0f || discriminant < 0.0f) {
+            return false;
+        }
+        t = (-b - std::sqrt(discriminant)) / a;
+        return true;
+    }
+
+    // moving sphere against the edge a-b as a cylinder, the caps are handled by RaySphere
+    static bool RayEdge(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, float radius, float& t) {
+
+        glm::vec3 ab = b - a;
+        glm::vec3 ao = origin - a;
+        float abab = glm::dot(ab, ab);
+        float abd = glm::dot(ab, direction);
+        float abao = glm::dot(ab, ao);
+
+        float qa = abab * glm::dot(direction, direction) - abd * abd;
+        float qb = abab * glm::dot(ao, direction) - abao * abd;
+        float qc = abab * glm::dot(ao, ao) - abao * abao - radius * radius * abab;
+        if (qc < 0.0f) {
+            // already touching: a contact only when moving further in
+            float s = abao / abab;
+            t = 0.0f;
+            return qb < 0.0f && s >= 0.0f && s <= 1.0f;
+        }
+        if (std::fabs(qa) < 1e-12f) {
+            return false;
+        }
+        float discriminant = qb * qb - qa * qc;
+        if (qb > 0.0f || discriminant < 0.0f) {
+            return false;
+        }
+        t = (-qb - std::sqrt(discriminant)) / qa;
+        float s = (abao + t * abd) / abab;
+        return s >= 0.0f && s <= 1.0f;
+    }
+
+    // first contact of a moving sphere with a triangle: the face, then the edges and corners
+    static bool SphereTriangle(const glm::vec3& origin, const glm::vec3& direction, float radius, const glm::vec3& v0,
+        const glm::vec3& e1, const glm::vec3& e2, float maxT, float& t, glm::vec3& normal) {
+
+        glm::vec3 v1 = v0 + e1;
+        glm::vec3 v2 = v0 + e2;
+        glm::vec3 faceNormal = glm::cross(e1, e2);
+        float length = glm::length(faceNormal);
+        if (length < 1e-12f) {
+            return false;
+        }
+        faceNormal /= length;
+        // the inside test follows the winding, whichever side the sphere is on
+        glm::vec3 windingNormal = faceNormal;
+
+        // the face towards the sphere
+        float distance = glm::dot(origin - v0, faceNormal);
+        if (distance < 0.0f) {
+            faceNormal = -faceNormal;
+            distance = -distance;
+        }
+
+        float approach = glm::dot(direction, faceNormal);
+        if (distance <= radius) {
+            if (approach < 0.0f && PointInTriangle(origin - faceNormal * distance, v0, v1, v2, windingNormal)) {
+                t = 0.0f;
+                normal = faceNormal;
+                return true;
+            }
+        }
+        else if (approach < 0.0f) {
+            float tFace = (radius - distance) / approach;
+            if (tFace <= maxT && PointInTriangle(origin + direction * tFace - faceNormal * radius, v0, v1, v2, windingNormal)) {
+                t = tFace;
+                normal = faceNormal;
+                return true;
+            }
+        }
+
+        // the sphere does not touch the inside of the face, the closest contact is on the border
+        float best = FLT_MAX;
+        const glm::vec3 corners[3] = { v0, v1, v2 };
+        for (int i = 0; i < 3; i++) {
+            float tEdge;
+            const glm::vec3& a = corners[i];
+            const glm::vec3& b = corners[(i + 1) % 3];
+            if (RayEdge(origin, direction, a, b, radius, tEdge) && tEdge < best) {
+                best = tEdge;
+                glm::vec3 center = origin + direction * tEdge;
+                float s = glm::dot(center - a, b - a) / glm::dot(b - a, b - a);
+                normal = center - (a + (b - a) * s);
+            }
+            float tCorner;
+            if (RaySphere(origin, direction, a, radius, tCorner) && tCorner < best) {
+                best = tCorner;
+                normal = origin + direction * tCorner - a;
+            }
+        }
+
+        if (best > maxT) {
+            return false;
+        }
+        t = best;
+        float normalLength = glm::length(normal);
+        normal = normalLength > 1e-12f ? normal / normalLength : faceNormal;
+        return true;
+    }
+
+    // --- TriangleBvh ---
+
+    void TriangleBvh::Build(const std::vector<gps::Mesh>& meshes) {
+
+        triangles.clear();
+        for (size_t m = 0; m < meshes.size(); m++) {
+            const gps::Mesh& mesh = meshes[m];
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                Triangle triangle;
+                triangle.v0 = mesh.vertices[mesh.indices[i]].Position;
+                triangle.e1 = mesh.vertices[mesh.indices[i + 1]].Position - triangle.v0;
+                triangle.e2 = mesh.vertices[mesh.indices[i + 2]].Position - triangle.v0;
+                triangles.push_back(triangle);
+            }
+        }
+
+        std::vector<glm::vec3> centroids(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i++) {
+            centroids[i] = triangles[i].v0 + (triangles[i].e1 + triangles[i].e2) * (1.0f / 3.0f);
+        }
+
+        // a binary tree has at most 2n - 1 nodes
+        nodes.clear();
+        nodes.reserve(std::max(triangles.size() * 2, (size_t)1));
+        BvhNode root;
+        root.leftOrFirst = 0;
+        root.count = (int)triangles.size();
+        nodes.push_back(root);
+        Subdivide(0, 0, centroids);
+    }
+
+    void TriangleBvh::Subdivide(int nodeIndex, int depth, std::vector<glm::vec3>& centroids) {
+
+        BvhNode& node = nodes[nodeIndex];
+        int first = node.leftOrFirst;
+        int count = node.count;
+
+        node.boundsMin = glm::vec3(FLT_MAX);
+        node.boundsMax = glm::vec3(-FLT_MAX);
+        glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+        for (int i = first; i < first + count; i++) {
+            const Triangle& triangle = triangles[i];
+            node.boundsMin = glm::min(node.boundsMin, glm::min(triangle.v0, glm::min(triangle.v0 + triangle.e1, triangle.v0 + triangle.e2)));
+            node.boundsMax = glm::max(node.boundsMax, glm::max(triangle.v0, glm::max(triangle.v0 + triangle.e1, triangle.v0 + triangle.e2)));
+            centroidMin = glm::min(centroidMin, centroids[i]);
+            centroidMax = glm::max(centroidMax, centroids[i]);
+        }
+        if (count <= MAX_LEAF_TRIANGLES || depth >= MAX_DEPTH) {
+            return;
+        }
+
+        // binned SAH over the three axes
+        int bestAxis = -1, bestSplit = 0;
+        float bestCost = count * SurfaceArea(node.boundsMin, node.boundsMax);
+        for (int axis = 0; axis < 3; axis++) {
+
+            float extent = centroidMax[axis] - centroidMin[axis];
+            if (extent <= 0.0f) {
+                continue;
+            }
+            float binScale = SAH_BINS / extent;
+
+            int binCount[SAH_BINS] = { 0 };
+            glm::vec3 binMin[SAH_BINS], binMax[SAH_BINS];
+            for (int b = 0; b < SAH_BINS; b++) {
+                binMin[b] = glm::vec3(FLT_MAX);
+                binMax[b] = glm::vec3(-FLT_MAX);
+            }
+            for (int i = first; i < first + count; i++) {
+                int b = std::min((int)((centroids[i][axis] - centroidMin[axis]) * binScale), SAH_BINS - 1);
+                const Triangle& triangle = triangles[i];
+                binCount[b]++;
+                binMin[b] = glm::min(binMin[b], glm::min(triangle.v0, glm::min(triangle.v0 + triangle.e1, triangle.v0 + triangle.e2)));
+                binMax[b] = glm::max(binMax[b], glm::max(triangle.v0, glm::max(triangle.v0 + triangle.e1, triangle.v0 + triangle.e2)));
+            }
+
+            // left side costs swept from the left, right side from the right
+            float leftCost[SAH_BINS - 1];
+            glm::vec3 sweepMin(FLT_MAX), sweepMax(-FLT_MAX);
+            int sweepCount = 0;
+            for (int b = 0; b < SAH_BINS - 1; b++) {
+                sweepCount += binCount[b];
+                if (binCount[b] > 0) {
+                    sweepMin = glm::min(sweepMin, binMin[b]);
+                    sweepMax = glm::max(sweepMax, binMax[b]);
+                }
+                leftCost[b] = sweepCount > 0 ? sweepCount * SurfaceArea(sweepMin, sweepMax) : 0.0f;
+            }
+            sweepMin = glm::vec3(FLT_MAX);
+            sweepMax = glm::vec3(-FLT_MAX);
+            sweepCount = 0;
+            for (int b = SAH_BINS - 1; b > 0; b--) {
+                sweepCount += binCount[b];
+                if (binCount[b] > 0) {
+                    sweepMin = glm::min(sweepMin, binMin[b]);
+                    sweepMax = glm::max(sweepMax, binMax[b]);
+                }
+                float cost = leftCost[b - 1] + (sweepCount > 0 ? sweepCount * SurfaceArea(sweepMin, sweepMax) : 0.0f);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
+                }
+            }
+        }
+
+        if (bestAxis < 0) {
+            return;
+        }
+
+        // partition in place, the triangles of the left bins first
+        float binScale = SAH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+        int i = first, j = first + count - 1;
+        while (i <= j) {
+            int b = std::min((int)((centroids[i][bestAxis] - centroidMin[bestAxis]) * binScale), SAH_BINS - 1);
+            if (b < bestSplit) {
+                i++;
+            }
+            else {
+                std::swap(triangles[i], triangles[j]);
+                std::swap(centroids[i], centroids[j]);
+                j--;
+            }
+        }
+        int leftCount = i - first;
+        if (leftCount == 0 || leftCount == count) {
+            return;
+        }
+
+        int leftIndex = (int)nodes.size();
+        BvhNode left, right;
+        left.leftOrFirst = first;
+        left.count = leftCount;
+        right.leftOrFirst = i;
+        right.count = count - leftCount;
+        nodes.push_back(left);
+        nodes.push_back(right);
+
+        // push_back may have moved the node
+        nodes[nodeIndex].leftOrFirst = leftIndex;
+        nodes[nodeIndex].count = 0;
+
+        Subdivide(leftIndex, depth + 1, centroids);
+        Subdivide(leftIndex + 1, depth + 1, centroids);
+    }
+
+    bool TriangleBvh::IsBuilt() const {
+
+        return !nodes.empty();
+    }
+
+    glm::vec3 TriangleBvh::GetBoundsMin() const {
+
+        return nodes.empty() ? glm::vec3(0.0f) : nodes[0].boundsMin;
+    }
+
+    glm::vec3 TriangleBvh::GetBoundsMax() const {
+
+        return nodes.empty() ? glm::vec3(0.0f) : nodes[0].boundsMax;
+    }
+
+    // front to back traversal: the nearer child first, and nodes entered after the best hit are skipped
+    template <typename Test>
+    bool TriangleBvh::Traverse(glm::vec3 origin, glm::vec3 direction, float inflate, float maxT, RayHit& hit, Test test) const {
+
+        if (nodes.empty() || triangles.empty()) {
+            return false;
+        }
+
+        glm::vec3 inverseDirection = InverseDirection(direction);
+        float best = maxT;
+        bool found = false;
+
+        int stack[STACK_SIZE];
+        int stackSize = 0;
+        float tEntry;
+        if (!IntersectBounds(nodes[0].boundsMin, nodes[0].boundsMax, inflate, origin, inverseDirection, best, tEntry)) {
+            return false;
+        }
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            const BvhNode& node = nodes[stack[--stackSize]];
+
+            if (node.count > 0) {
+                for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                    float t;
+                    glm::vec3 normal;
+                    if (test(triangles[i], best, t, normal) && t <= best) {
+                        best = t;
+                        found = true;
+                        hit.t = t;
+                        hit.normal = normal;
+                        hit.triangle = i;
+                    }
+                }
+                continue;
+            }
+
+            int near = node.leftOrFirst, far = node.leftOrFirst + 1;
+            float tNear, tFar;
+            bool hitNear = IntersectBounds(nodes[near].boundsMin, nodes[near].boundsMax, inflate, origin, inverseDirection, best, tNear);
+            bool hitFar = IntersectBounds(nodes[far].boundsMin, nodes[far].boundsMax, inflate, origin, inverseDirection, best, tFar);
+            if (hitNear && hitFar) {
+                if (tFar < tNear) {
+                    std::swap(near, far);
+                }
+                // the stack is popped from the top, the nearer child goes in last
+                stack[stackSize++] = far;
+                stack[stackSize++] = near;
+            }
+            else if (hitNear || hitFar) {
+                stack[stackSize++] = hitNear ? near : far;
+            }
+        }
+
+        hit.instance = -1;
+        return found;
+    }
+
+    bool TriangleBvh::Raycast(glm::vec3 origin, glm::vec3 direction, float maxT, RayHit& hit) const {
+
+        return Traverse(origin, direction, 0.0f, maxT, hit,
+            [&](const Triangle& triangle, float best, float& t, glm::vec3& normal) {
+                if (!RayTriangle(origin, direction, triangle.v0, triangle.e1, triangle.e2, best, t)) {
+                    return false;
+                }
+                // facing the ray
+                normal = glm::normalize(glm::cross(triangle.e1, triangle.e2));
+                if (glm::dot(normal, direction) > 0.0f) {
+                    normal = -normal;
+                }
+                return true;
+            });
+    }
+
+    bool TriangleBvh::SphereCast(glm::vec3 origin, glm::vec3 direction, float radius, float maxT, RayHit& hit) const {
+
+        return Traverse(origin, direction, radius, maxT, hit,
+            [&](const Triangle& triangle, float best, float& t, glm::vec3& normal) {
+                return SphereTriangle(origin, direction, radius, triangle.v0, triangle.e1, triangle.e2, best, t, normal);
+            });
+    }
+
+    // --- SceneBvh ---
+
+    void SceneBvh::Build(const std::vector<BvhInstance>& source) {
+
+        instances.clear();
+        std::vector<glm::vec3> boundsMin, boundsMax, centers;
+
+        for (size_t i = 0; i < source.size(); i++) {
+            Instance instance;
+            instance.bvh = source[i].bvh;
+            instance.modelMatrix = source[i].modelMatrix;
+            instance.inverseMatrix = glm::inverse(source[i].modelMatrix);
+            instance.scale = glm::length(glm::vec3(source[i].modelMatrix[0]));
+            instances.push_back(instance);
+
+            // world bounds of the 8 transformed corners
+            glm::vec3 localMin = instance.bvh->GetBoundsMin(), localMax = instance.bvh->GetBoundsMax();
+            glm::vec3 worldMin(FLT_MAX), worldMax(-FLT_MAX);
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec3 p((corner & 1) ? localMax.x : localMin.x, (corner & 2) ? localMax.y : localMin.y, (corner & 4) ? localMax.z : localMin.z);
+                p = glm::vec3(instance.modelMatrix * glm::vec4(p, 1.0f));
+                worldMin = glm::min(worldMin, p);
+                worldMax = glm::max(worldMax, p);
+            }
+            boundsMin.push_back(worldMin);
+            boundsMax.push_back(worldMax);
+            centers.push_back((worldMin + worldMax) * 0.5f);
+        }
+
+        // few instances: median splits along the widest axis of the centers are good enough
+        instanceOrder.resize(instances.size());
+        for (size_t i = 0; i < instanceOrder.size(); i++) {
+            instanceOrder[i] = (int)i;
+        }
+
+        nodes.clear();
+        BvhNode root;
+        root.leftOrFirst = 0;
+        root.count = (int)instances.size();
+        nodes.push_back(root);
+
+        // (node, depth) pairs still to split
+        std::vector<std::pair<int, int> > work(1, std::make_pair(0, 0));
+        while (!work.empty()) {
+            int nodeIndex = work.back().first;
+            int depth = work.back().second;
+            work.pop_back();
+
+            int first = nodes[nodeIndex].leftOrFirst, count = nodes[nodeIndex].count;
+            glm::vec3 nodeMin(FLT_MAX), nodeMax(-FLT_MAX), centerMin(FLT_MAX), centerMax(-FLT_MAX);
+            for (int i = first; i < first + count; i++) {
+                int instance = instanceOrder[i];
+                nodeMin = glm::min(nodeMin, boundsMin[instance]);
+                nodeMax = glm::max(nodeMax, boundsMax[instance]);
+                centerMin = glm::min(centerMin, centers[instance]);
+                centerMax = glm::max(centerMax, centers[instance]);
+            }
+            nodes[nodeIndex].boundsMin = nodeMin;
+            nodes[nodeIndex].boundsMax = nodeMax;
+            if (count <= 2 || depth >= MAX_DEPTH) {
+                continue;
+            }
+
+            glm::vec3 extent = centerMax - centerMin;
+            int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+            int half = count / 2;
+            std::nth_element(instanceOrder.begin() + first, instanceOrder.begin() + first + half, instanceOrder.begin() + first + count,
+                [&](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+
+            int leftIndex = (int)nodes.size();
+            BvhNode left, right;
+            left.leftOrFirst = first;
+            left.count = half;
+            right.leftOrFirst = first + half;
+            right.count = count - half;
+            nodes.push_back(left);
+            nodes.push_back(right);
+            nodes[nodeIndex].leftOrFirst = leftIndex;
+            nodes[nodeIndex].count = 0;
+            work.push_back(std::make_pair(leftIndex, depth + 1));
+            work.push_back(std::make_pair(leftIndex + 1, depth + 1));
+        }
+    }
+
+    bool SceneBvh::Query(glm::vec3 origin, glm::vec3 direction, float radius, float maxT, RayHit& hit) const {
+
+        if (instances.empty()) {
+            return false;
+        }
+
+        glm::vec3 inverseDirection = InverseDirection(direction);
+        float best = maxT;
+        bool found = false;
+
+        int stack[STACK_SIZE];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            const BvhNode& node = nodes[stack[--stackSize]];
+            float tEntry;
+            if (!IntersectBounds(node.boundsMin, node.boundsMax, radius, origin, inverseDirection, best, tEntry)) {
+                continue;
+            }
+
+            if (node.count == 0) {
+                stack[stackSize++] = node.leftOrFirst + 1;
+                stack[stackSize++] = node.leftOrFirst;
+                continue;
+            }
+
+            for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                const Instance& instance = instances[instanceOrder[i]];
+
+                // t is the same in both spaces, the direction is transformed without normalizing
+                glm::vec3 localOrigin = glm::vec3(instance.inverseMatrix * glm::vec4(origin, 1.0f));
+                glm::vec3 localDirection = glm::vec3(instance.inverseMatrix * glm::vec4(direction, 0.0f));
+
+                RayHit local;
+                bool instanceHit = radius > 0.0f
+                    ? instance.bvh->SphereCast(localOrigin, localDirection, radius / instance.scale, best, local)
+                    : instance.bvh->Raycast(localOrigin, localDirection, best, local);
+                if (instanceHit && local.t <= best) {
+                    best = local.t;
+                    found = true;
+                    hit = local;
+                    hit.instance = instanceOrder[i];
+                    hit.normal = glm::normalize(glm::vec3(glm::transpose(instance.inverseMatrix) * glm::vec4(local.normal, 0.0f)));
+                }
+            }
+        }
+        return found;
+    }
+
+    bool SceneBvh::Raycast(glm::vec3 origin, glm::vec3 direction, float maxT, RayHit& hit) const {
+
+        return Query(origin, direction, 0.0f, maxT, hit);
+    }
+
+    bool SceneBvh::Segment(glm::vec3 from, glm::vec3 to, RayHit& hit) const {
+
+        return Query(from, to - from, 0.0f, 1.0f, hit);
+    }
+
+    bool SceneBvh::SphereCast(glm::vec3 origin, glm::vec3 direction, float radius, float maxT, RayHit& hit) const {
+
+        return Query(origin, direction, radius, maxT, hit);
+    }
+}
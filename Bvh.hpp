@@ -0,0 +1,92 @@
+#ifndef Bvh_hpp
+#define Bvh_hpp
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    struct RayHit {
+        // origin + t * direction is the hit point (the sphere center for sphere casts)
+        float t;
+        glm::vec3 normal;
+        int triangle;
+        // index of the instance in SceneBvh::Build(), -1 for a TriangleBvh query
+        int instance;
+    };
+
+    // node of both BVH levels: a leaf holds count primitives starting at leftOrFirst,
+    // an inner node (count == 0) has its children at leftOrFirst and leftOrFirst + 1
+    struct BvhNode {
+        glm::vec3 boundsMin;
+        int leftOrFirst;
+        glm::vec3 boundsMax;
+        int count;
+    };
+
+    // Triangle BVH in object space, built with binned SAH from the CPU copy of the meshes.
+    // Queries take an unnormalized direction and t in [0, maxT], so a segment a -> b is
+    // (a, b - a, 1). Triangles are two-sided.
+    class TriangleBvh {
+
+    public:
+        void Build(const std::vector<gps::Mesh>& meshes);
+        bool IsBuilt() const;
+
+        glm::vec3 GetBoundsMin() const;
+        glm::vec3 GetBoundsMax() const;
+
+        bool Raycast(glm::vec3 origin, glm::vec3 direction, float maxT, RayHit& hit) const;
+        // first contact of a sphere moving along the ray; hit.normal points away from the surface
+        bool SphereCast(glm::vec3 origin, glm::vec3 direction, float radius, float maxT, RayHit& hit) const;
+
+    private:
+        // one vertex and two edges, the layout the intersection tests want
+        struct Triangle {
+            glm::vec3 v0, e1, e2;
+        };
+
+        std::vector<BvhNode> nodes;
+        std::vector<Triangle> triangles;
+
+        void Subdivide(int node, int depth, std::vector<glm::vec3>& centroids);
+        template <typename Test> bool Traverse(glm::vec3 origin, glm::vec3 direction, float inflate, float maxT, RayHit& hit, Test test) const;
+    };
+
+    // a placed model; the sphere cast assumes a uniform scale
+    struct BvhInstance {
+        const TriangleBvh* bvh;
+        glm::mat4 modelMatrix;
+    };
+
+    // BVH over instances: world space queries are transformed into every candidate
+    // instance and answered by its TriangleBvh.
+    class SceneBvh {
+
+    public:
+        void Build(const std::vector<BvhInstance>& instances);
+
+        bool Raycast(glm::vec3 origin, glm::vec3 direction, float maxT, RayHit& hit) const;
+        bool Segment(glm::vec3 from, glm::vec3 to, RayHit& hit) const;
+        bool SphereCast(glm::vec3 origin, glm::vec3 direction, float radius, float maxT, RayHit& hit) const;
+
+    private:
+        struct Instance {
+            const TriangleBvh* bvh;
+            glm::mat4 modelMatrix;
+            glm::mat4 inverseMatrix;
+            float scale;
+        };
+
+        std::vector<BvhNode> nodes;
+        std::vector<Instance> instances;
+        std::vector<int> instanceOrder;
+
+        bool Query(glm::vec3 origin, glm::vec3 direction, float radius, float maxT, RayHit& hit) const;
+    };
+}
+
+#endif /* Bvh_hpp */
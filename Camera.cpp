@@ -74,4 +74,8 @@ namespace gps {
         this->cameraTarget = this->cameraPosition + this->cameraFrontDirection;
     }
 
+    glm::vec3 Camera::getFrontDirection() const {
+        return this->cameraFrontDirection;
+    }
+
 }
\ No newline at end of file
@@ -18,6 +18,7 @@ namespace gps {
 
         glm::vec3 getPosition() const;
         void setPosition(glm::vec3 newPosition);
+        glm::vec3 getFrontDirection() const;
         
     private:
         glm::vec3 cameraPosition;
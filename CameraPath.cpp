@@ -0,0 +1,179 @@
+#include "CameraPath.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace gps {
+
+    // keeps the knots of repeated keys apart
+    static const float MIN_KEY_DISTANCE = 1e-4f;
+
+    static float KnotInterval(const glm::vec3& a, const glm::vec3& b) {
+
+        return std::sqrt(std::max(glm::length(b - a), MIN_KEY_DISTANCE));
+    }
+
+    // centripetal Catmull-Rom between p1 and p2 (Barry-Goldman): knots spaced by the square
+    // root of the key distance, so unevenly spaced keys give no loops or overshoots
+    static glm::vec3 CatmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t) {
+
+        float t0 = 0.0f;
+        float t1 = t0 + KnotInterval(p0, p1);
+        float t2 = t1 + KnotInterval(p1, p2);
+        float t3 = t2 + KnotInterval(p2, p3);
+        float u = t1 + (t2 - t1) * t;
+
+        glm::vec3 a1 = ((t1 - u) * p0 + (u - t0) * p1) / (t1 - t0);
+        glm::vec3 a2 = ((t2 - u) * p1 + (u - t1) * p2) / (t2 - t1);
+        glm::vec3 a3 = ((t3 - u) * p2 + (u - t2) * p3) / (t3 - t2);
+        glm::vec3 b1 = ((t2 - u) * a1 + (u - t0) * a2) / (t2 - t0);
+        glm::vec3 b2 = ((t3 - u) * a2 + (u - t1) * a3) / (t3 - t1);
+        return ((t2 - u) * b1 + (u - t1) * b2) / (t2 - t1);
+    }
+
+    bool CameraPath::Load(const std::string& fileName) {
+
+        std::ifstream file(fileName.c_str());
+        if (!file) {
+            std::cerr << "Could not open camera path: " << fileName << std::endl;
+            return false;
+        }
+
+        std::vector<CameraPathKey> fileKeys;
+        bool fileLoop = false;
+        float fileSpeed = 5.0f;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            line = line.substr(0, line.find('#'));
+
+            std::istringstream stream(line);
+            std::string word;
+            if (!(stream >> word)) {
+                continue;
+            }
+            if (word == "loop") {
+                fileLoop = true;
+                continue;
+            }
+            if (word == "speed") {
+                if (!(stream >> fileSpeed) || fileSpeed <= 0.0f) {
+                    std::cerr << fileName << ":" << lineNumber << ": invalid speed" << std::endl;
+                    return false;
+                }
+                continue;
+            }
+
+            CameraPathKey key;
+            std::istringstream keyStream(line);
+            if (!(keyStream >> key.position.x >> key.position.y >> key.position.z
+                >> key.target.x >> key.target.y >> key.target.z)) {
+                std::cerr << fileName << ":" << lineNumber << ": expected \"x y z tx ty tz\"" << std::endl;
+                return false;
+            }
+            fileKeys.push_back(key);
+        }
+
+        if (fileKeys.size() < 2) {
+            std::cerr << fileName << ": a camera path needs at least two keys" << std::endl;
+            return false;
+        }
+        Create(fileKeys, fileLoop, fileSpeed);
+        return true;
+    }
+
+    void CameraPath::Create(const std::vector<CameraPathKey>& keys, bool loop, float speed) {
+
+        this->keys = keys;
+        this->loop = loop;
+        this->speed = speed;
+
+        // the arc length is summed over short chords of the curve
+        int segments = GetSegmentCount();
+        arcLengths.resize(segments * SAMPLES_PER_SEGMENT + 1);
+        arcLengths[0] = 0.0f;
+        glm::vec3 previous = EvaluateSegment(0, 0.0f).position;
+        for (int i = 1; i < (int)arcLengths.size(); i++) {
+            int segment = std::min((i - 1) / SAMPLES_PER_SEGMENT, segments - 1);
+            float t = (float)(i - segment * SAMPLES_PER_SEGMENT) / SAMPLES_PER_SEGMENT;
+            glm::vec3 point = EvaluateSegment(segment, t).position;
+            arcLengths[i] = arcLengths[i - 1] + glm::length(point - previous);
+            previous = point;
+        }
+    }
+
+    float CameraPath::GetLength() const {
+
+        return arcLengths.empty() ? 0.0f : arcLengths.back();
+    }
+
+    float CameraPath::GetSpeed() const {
+
+        return speed;
+    }
+
+    int CameraPath::GetSegmentCount() const {
+
+        return loop ? (int)keys.size() : (int)keys.size() - 1;
+    }
+
+    // an open path gets a key mirrored past each end, so it leaves the end keys straight
+    CameraPathKey CameraPath::GetKey(int index) const {
+
+        int count = (int)keys.size();
+        if (loop) {
+            return keys[((index % count) + count) % count];
+        }
+        if (index < 0) {
+            CameraPathKey key = { 2.0f * keys[0].position - keys[1].position, 2.0f * keys[0].target - keys[1].target };
+            return key;
+        }
+        if (index >= count) {
+            CameraPathKey key = { 2.0f * keys[count - 1].position - keys[count - 2].position,
+                2.0f * keys[count - 1].target - keys[count - 2].target };
+            return key;
+        }
+        return keys[index];
+    }
+
+    CameraPathKey CameraPath::EvaluateSegment(int segment, float t) const {
+
+        CameraPathKey k0 = GetKey(segment - 1);
+        CameraPathKey k1 = GetKey(segment);
+        CameraPathKey k2 = GetKey(segment + 1);
+        CameraPathKey k3 = GetKey(segment + 2);
+
+        CameraPathKey key;
+        key.position = CatmullRom(k0.position, k1.position, k2.position, k3.position, t);
+        key.target = CatmullRom(k0.target, k1.target, k2.target, k3.target, t);
+        return key;
+    }
+
+    void CameraPath::Evaluate(float distance, glm::vec3& position, glm::vec3& target) const {
+
+        float length = GetLength();
+        if (loop && length > 0.0f) {
+            distance = std::fmod(distance, length);
+            if (distance < 0.0f) {
+                distance += length;
+            }
+        }
+        distance = std::min(std::max(distance, 0.0f), length);
+
+        // the sample interval holding distance, then linear between its two samples
+        int sample = (int)(std::upper_bound(arcLengths.begin(), arcLengths.end(), distance) - arcLengths.begin()) - 1;
+        sample = std::min(std::max(sample, 0), (int)arcLengths.size() - 2);
+        float interval = arcLengths[sample + 1] - arcLengths[sample];
+        float fraction = interval > 0.0f ? (distance - arcLengths[sample]) / interval : 0.0f;
+
+        float u = (sample + fraction) / SAMPLES_PER_SEGMENT;
+        int segment = std::min((int)u, GetSegmentCount() - 1);
+        CameraPathKey key = EvaluateSegment(segment, u - segment);
+        position = key.position;
+        target = key.target;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef CameraPath_hpp
+#define CameraPath_hpp
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    struct CameraPathKey {
+        glm::vec3 position;
+        // the point the camera looks at
+        glm::vec3 target;
+    };
+
+    // Catmull-Rom spline through camera keys, evaluated by distance along the curve instead of
+    // by spline parameter, so the camera moves at the same speed between close and far keys.
+    // The target follows its own spline over the same parameter.
+    class CameraPath {
+
+    public:
+        // one key per line, "x y z  tx ty tz"; "speed <m/s>" and "loop" lines are optional,
+        // '#' starts a comment
+        bool Load(const std::string& fileName);
+        // needs at least two keys; a looped path returns from the last key to the first
+        void Create(const std::vector<CameraPathKey>& keys, bool loop, float speed);
+
+        // meters
+        float GetLength() const;
+        // meters per second
+        float GetSpeed() const;
+
+        // at distance meters from the first key, clamped to the ends (wrapped if looped)
+        void Evaluate(float distance, glm::vec3& position, glm::vec3& target) const;
+
+    private:
+        static const int SAMPLES_PER_SEGMENT = 128;
+
+        std::vector<CameraPathKey> keys;
+        bool loop;
+        float speed;
+        // arc length from the first key up to every sample, SAMPLES_PER_SEGMENT per segment
+        std::vector<float> arcLengths;
+
+        int GetSegmentCount() const;
+        CameraPathKey GetKey(int index) const;
+        CameraPathKey EvaluateSegment(int segment, float t) const;
+    };
+}
+
+#endif /* CameraPath_hpp */
@@ -0,0 +1,243 @@
+#include "CascadedShadowMap.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+namespace gps {
+
+    // how far behind a cascade (towards the light) casters are still captured
+    const float CASTER_PADDING = 100.0f;
+    // blend between logarithmic (1.0) and uniform (0.0) split distribution
+    const float SPLIT_LAMBDA = 0.75f;
+
+    void CascadedShadowMap::Create(int resolution, int cascadeCount) {
+
+        this->resolution = resolution;
+        this->cascadeCount = glm::clamp(cascadeCount, 1, MAX_CASCADES);
+
+        // the live layers are sampled with hardware PCF, the static cache is only blitted
+        depthTexture = CreateDepthArray(true);
+        staticDepthTexture = CreateDepthArray(false);
+
+        glGenFramebuffers(this->cascadeCount, liveFBO);
+        glGenFramebuffers(this->cascadeCount, staticFBO);
+
+        for (int i = 0; i < this->cascadeCount; i++) {
+
+            glBindFramebuffer(GL_FRAMEBUFFER, liveFBO[i]);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0, i);
+            glDrawBuffer(GL_NONE); glReadBuffer(GL_NONE);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, staticFBO[i]);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, staticDepthTexture, 0, i);
+            glDrawBuffer(GL_NONE); glReadBuffer(GL_NONE);
+
+            ShadowCascade& cascade = cascades[i];
+            cascade.lightView = glm::mat4(1.0f);
+            cascade.lightSpaceMatrix = glm::mat4(1.0f);
+            cascade.staticLightSpaceMatrix = glm::mat4(1.0f);
+            cascade.radius = 0.0f;
+            cascade.depthNear = 0.0f;
+            cascade.depthFar = 0.0f;
+            // near cascades every frame, far ones progressively less often
+            cascade.updateInterval = (i < 2) ? 1 : (1 << (i - 1));
+            // force a fit on the first Update
+            cascade.framesSinceUpdate = cascade.updateInterval;
+            cascade.due = false;
+            cascade.staticValid = false;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void CascadedShadowMap::Delete() {
+
+        glDeleteFramebuffers(cascadeCount, liveFBO);
+        glDeleteFramebuffers(cascadeCount, staticFBO);
+        glDeleteTextures(1, &depthTexture);
+        glDeleteTextures(1, &staticDepthTexture);
+    }
+
+    GLuint CascadedShadowMap::CreateDepthArray(bool compareMode) {
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, cascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        if (compareMode) {
+            // sampler2DArrayShadow - every fetch returns a bilinearly filtered 2x2 depth comparison
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        }
+        else {
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return texture;
+    }
+
+    void CascadedShadowMap::SetUpdateInterval(int cascade, int frames) {
+
+        cascades[cascade].updateInterval = glm::max(frames, 1);
+    }
+
+    void CascadedShadowMap::ComputeSplits(float nearPlane, float farPlane) {
+
+        float previous = nearPlane;
+        for (int i = 0; i < cascadeCount; i++) {
+
+            float p = (float)(i + 1) / (float)cascadeCount;
+            float logSplit = nearPlane * std::pow(farPlane / nearPlane, p);
+            float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+
+            cascades[i].splitNear = previous;
+            cascades[i].splitFar = SPLIT_LAMBDA * logSplit + (1.0f - SPLIT_LAMBDA) * uniformSplit;
+            previous = cascades[i].splitFar;
+        }
+    }
+
+    void CascadedShadowMap::FitCascade(ShadowCascade& cascade, const glm::mat4& invViewMatrix, float fovY, float aspect, glm::vec3 lightDir) {
+
+        // bounding sphere of the frustum slice - its radius does not depend on the camera orientation,
+        // so the ortho extent stays constant and the shadow does not shimmer when looking around
+        float tanY = std::tan(fovY * 0.5f);
+        float tanX = tanY * aspect;
+        glm::vec3 corners[8];
+        glm::vec3 center = glm::vec3(0.0f);
+        for (int i = 0; i < 8; i++) {
+
+            float d = (i < 4) ? cascade.splitNear : cascade.splitFar;
+            float sx = (i & 1) ? 1.0f : -1.0f;
+            float sy = (i & 2) ? 1.0f : -1.0f;
+            corners[i] = glm::vec3(invViewMatrix * glm::vec4(sx * tanX * d, sy * tanY * d, -d, 1.0f));
+            center += corners[i];
+        }
+        center /= 8.0f;
+
+        float radius = 0.0f;
+        for (int i = 0; i < 8; i++) {
+            radius = glm::max(radius, glm::length(corners[i] - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // rotation only light view, the translation is snapped below
+        glm::vec3 lightDirN = glm::normalize(lightDir);
+        glm::vec3 up = (std::abs(lightDirN.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), -lightDirN, up);
+
+        // snap the center to whole shadow texels (and coarse depth steps) in light space,
+        // the matrix then only changes when the camera crosses a texel
+        float texelSize = 2.0f * radius / (float)resolution;
+        float depthStep = radius * 0.25f;
+        glm::vec3 centerLS = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+        centerLS.x = std::floor(centerLS.x / texelSize) * texelSize;
+        centerLS.y = std::floor(centerLS.y / texelSize) * texelSize;
+        centerLS.z = std::floor(centerLS.z / depthStep) * depthStep;
+
+        cascade.radius = radius;
+        cascade.depthNear = -(radius + depthStep + CASTER_PADDING);
+        cascade.depthFar = radius + depthStep;
+        cascade.lightView = glm::translate(glm::mat4(1.0f), -centerLS) * lightRotation;
+        glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, cascade.depthNear, cascade.depthFar);
+        cascade.lightSpaceMatrix = lightProjection * cascade.lightView;
+    }
+
+    void CascadedShadowMap::Update(const glm::mat4& viewMatrix, float fovY, float aspect, float nearPlane, float farPlane, glm::vec3 lightDir) {
+
+        ComputeSplits(nearPlane, farPlane);
+        glm::mat4 invViewMatrix = glm::inverse(viewMatrix);
+
+        for (int i = 0; i < cascadeCount; i++) {
+
+            ShadowCascade& cascade = cascades[i];
+            cascade.framesSinceUpdate++;
+            cascade.due = !cascade.staticValid || cascade.framesSinceUpdate >= cascade.updateInterval;
+
+            if (cascade.due) {
+                FitCascade(cascade, invViewMatrix, fovY, aspect, lightDir);
+                cascade.framesSinceUpdate = 0;
+            }
+        }
+    }
+
+    void CascadedShadowMap::InvalidateStatic() {
+
+        for (int i = 0; i < cascadeCount; i++) {
+            cascades[i].staticValid = false;
+        }
+    }
+
+    bool CascadedShadowMap::IsDue(int cascade) const {
+
+        return cascades[cascade].due;
+    }
+
+    bool CascadedShadowMap::NeedsStaticRefresh(int cascade) const {
+
+        return !cascades[cascade].staticValid || cascades[cascade].staticLightSpaceMatrix != cascades[cascade].lightSpaceMatrix;
+    }
+
+    void CascadedShadowMap::BeginStatic(int cascade) {
+
+        glBindFramebuffer(GL_FRAMEBUFFER, staticFBO[cascade]);
+        glViewport(0, 0, resolution, resolution);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        cascades[cascade].staticValid = true;
+        cascades[cascade].staticLightSpaceMatrix = cascades[cascade].lightSpaceMatrix;
+    }
+
+    void CascadedShadowMap::BeginDynamic(int cascade) {
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFBO[cascade]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, liveFBO[cascade]);
+        glBlitFramebuffer(0, 0, resolution, resolution, 0, 0, resolution, resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, liveFBO[cascade]);
+        glViewport(0, 0, resolution, resolution);
+    }
+
+    bool CascadedShadowMap::IsVisible(int cascade, glm::vec3 center, float radius) const {
+
+        const ShadowCascade& c = cascades[cascade];
+        glm::vec3 p = glm::vec3(c.lightView * glm::vec4(center, 1.0f));
+
+        // view space looks down -z, so depthNear/depthFar map to -z
+        return std::abs(p.x) <= c.radius + radius &&
+            std::abs(p.y) <= c.radius + radius &&
+            -p.z >= c.depthNear - radius &&
+            -p.z <= c.depthFar + radius;
+    }
+
+    glm::mat4 CascadedShadowMap::GetLightSpaceMatrix(int cascade) const {
+
+        return cascades[cascade].lightSpaceMatrix;
+    }
+
+    float CascadedShadowMap::GetSplitDistance(int cascade) const {
+
+        return cascades[cascade].splitFar;
+    }
+
+    int CascadedShadowMap::GetCascadeCount() const {
+
+        return cascadeCount;
+    }
+
+    int CascadedShadowMap::GetResolution() const {
+
+        return resolution;
+    }
+
+    GLuint CascadedShadowMap::GetDepthTexture() const {
+
+        return depthTexture;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef CascadedShadowMap_hpp
+#define CascadedShadowMap_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <glm/glm.hpp>
+
+namespace gps {
+
+    struct ShadowCascade {
+        // view-space depth range of the camera frustum covered by this cascade
+        float splitNear;
+        float splitFar;
+        // light space matrix the cascade layer was last rendered with
+        glm::mat4 lightView;
+        glm::mat4 lightSpaceMatrix;
+        float radius;
+        // light view space depth range, the near side is pushed towards the light to catch casters outside the slice
+        float depthNear;
+        float depthFar;
+        // re-render every updateInterval frames
+        int updateInterval;
+        int framesSinceUpdate;
+        bool due;
+        // static casters are cached per cascade and reused while the matrix stays the same
+        bool staticValid;
+        glm::mat4 staticLightSpaceMatrix;
+    };
+
+    class CascadedShadowMap {
+
+    public:
+        static const int MAX_CASCADES = 4;
+
+        void Create(int resolution, int cascadeCount);
+        void Delete();
+
+        void SetUpdateInterval(int cascade, int frames);
+
+        // fits every due cascade to its slice of the camera frustum
+        void Update(const glm::mat4& viewMatrix, float fovY, float aspect, float nearPlane, float farPlane, glm::vec3 lightDir);
+
+        // forces all cascades to re-render their static casters
+        void InvalidateStatic();
+
+        bool IsDue(int cascade) const;
+        bool NeedsStaticRefresh(int cascade) const;
+
+        // binds the static cache layer for rendering static casters
+        void BeginStatic(int cascade);
+        // copies the static cache into the live layer and binds it for the dynamic casters
+        void BeginDynamic(int cascade);
+
+        // sphere vs cascade ortho box test, used to cull shadow casters
+        bool IsVisible(int cascade, glm::vec3 center, float radius) const;
+
+        glm::mat4 GetLightSpaceMatrix(int cascade) const;
+        float GetSplitDistance(int cascade) const;
+        int GetCascadeCount() const;
+        int GetResolution() const;
+        GLuint GetDepthTexture() const;
+
+    private:
+        int resolution;
+        int cascadeCount;
+        ShadowCascade cascades[MAX_CASCADES];
+
+        GLuint depthTexture;
+        GLuint staticDepthTexture;
+        GLuint liveFBO[MAX_CASCADES];
+        GLuint staticFBO[MAX_CASCADES];
+
+        GLuint CreateDepthArray(bool compareMode);
+        void ComputeSplits(float nearPlane, float farPlane);
+        void FitCascade(ShadowCascade& cascade, const glm::mat4& invViewMatrix, float fovY, float aspect, glm::vec3 lightDir);
+    };
+}
+
+#endif /* CascadedShadowMap_hpp */
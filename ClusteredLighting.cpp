@@ -0,0 +1,250 @@
+#include "ClusteredLighting.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gps {
+
+    float ComputeLightRadius(glm::vec3 color, float constant, float linear, float quadratic) {
+
+        float brightest = glm::max(color.r, glm::max(color.g, color.b));
+        if (brightest <= 0.0f)
+            return 0.0f;
+
+        // brightest / (constant + linear * d + quadratic * d^2) = 1 / 256
+        float c = constant - brightest * 256.0f;
+        if (quadratic <= 0.0f)
+            return (linear > 0.0f) ? -c / linear : 0.0f;
+
+        return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+    }
+
+    void LightClusterer::Create(JobSystem& jobSystem) {
+
+        this->jobSystem = &jobSystem;
+
+        glGenBuffers(1, &lightBuffer);
+        glGenBuffers(1, &gridBuffer);
+        glGenBuffers(1, &indexBuffer);
+
+        glGenTextures(1, &lightTexture);
+        glGenTextures(1, &gridTexture);
+        glGenTextures(1, &indexTexture);
+
+        clusterCounts.assign(CLUSTER_COUNT, 0);
+        slicePairs.resize(CLUSTERS_Z);
+        gridData.assign(CLUSTER_COUNT * 2, 0);
+    }
+
+    void LightClusterer::Delete() {
+
+        glDeleteTextures(1, &lightTexture);
+        glDeleteTextures(1, &gridTexture);
+        glDeleteTextures(1, &indexTexture);
+        glDeleteBuffers(1, &lightBuffer);
+        glDeleteBuffers(1, &gridBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+    }
+
+    float LightClusterer::SliceDepth(int slice) const {
+
+        // exponential slicing keeps froxels roughly cubic along the view direction
+        return nearPlane * std::pow(farPlane / nearPlane, (float)slice / (float)CLUSTERS_Z);
+    }
+
+    void LightClusterer::BuildClusterBounds() {
+
+        clusterBounds.resize(CLUSTER_COUNT);
+
+        float tanY = std::tan(fovY * 0.5f);
+        float tanX = tanY * aspect;
+
+        for (int z = 0; z < CLUSTERS_Z; z++) {
+
+            float depths[2] = { SliceDepth(z), SliceDepth(z + 1) };
+
+            for (int y = 0; y < CLUSTERS_Y; y++) {
+                for (int x = 0; x < CLUSTERS_X; x++) {
+
+                    float ndcX[2] = { -1.0f + 2.0f * x / CLUSTERS_X, -1.0f + 2.0f * (x + 1) / CLUSTERS_X };
+                    float ndcY[2] = { -1.0f + 2.0f * y / CLUSTERS_Y, -1.0f + 2.0f * (y + 1) / CLUSTERS_Y };
+
+                    ClusterBounds bounds;
+                    bounds.min = glm::vec3(1e30f);
+                    bounds.max = glm::vec3(-1e30f);
+                    for (int i = 0; i < 8; i++) {
+
+                        float d = depths[i >> 2];
+                        glm::vec3 corner(ndcX[i & 1] * tanX * d, ndcY[(i >> 1) & 1] * tanY * d, -d);
+                        bounds.min = glm::min(bounds.min, corner);
+                        bounds.max = glm::max(bounds.max, corner);
+                    }
+                    clusterBounds[x + CLUSTERS_X * (y + CLUSTERS_Y * z)] = bounds;
+                }
+            }
+        }
+    }
+
+    void LightClusterer::AssignSlices(int firstSlice, int lastSlice) {
+
+        float tanY = std::tan(fovY * 0.5f);
+        float tanX = tanY * aspect;
+        float logDepthScale = CLUSTERS_Z / std::log(farPlane / nearPlane);
+
+        for (int z = firstSlice; z <= lastSlice; z++) {
+            slicePairs[z].clear();
+        }
+
+        for (size_t i = 0; i < lightPositions.size(); i++) {
+
+            glm::vec3 center = glm::vec3(lightPositions[i]);
+            float radius = lightRadii[i];
+            float depth = -center.z;
+
+            if (depth + radius < nearPlane || depth - radius > farPlane)
+                continue;
+
+            // slices overlapped by the sphere, restricted to this worker's range
+            int z0 = (int)std::floor(std::log(glm::max(depth - radius, nearPlane) / nearPlane) * logDepthScale);
+            int z1 = (int)std::floor(std::log(glm::min(depth + radius, farPlane) / nearPlane) * logDepthScale);
+            z0 = glm::max(z0, firstSlice);
+            z1 = glm::min(z1, glm::min(lastSlice, CLUSTERS_Z - 1));
+
+            for (int z = z0; z <= z1; z++) {
+
+                // conservative tile rectangle of the sphere inside this slice
+                float dMin = glm::max(SliceDepth(z), depth - radius);
+                float dMax = glm::min(SliceDepth(z + 1), depth + radius);
+                if (dMin > dMax)
+                    continue;
+
+                float xLo = center.x - radius, xHi = center.x + radius;
+                float yLo = center.y - radius, yHi = center.y + radius;
+                float ndcXLo = xLo / ((xLo < 0.0f) ? dMin : dMax) / tanX;
+                float ndcXHi = xHi / ((xHi > 0.0f) ? dMin : dMax) / tanX;
+                float ndcYLo = yLo / ((yLo < 0.0f) ? dMin : dMax) / tanY;
+                float ndcYHi = yHi / ((yHi > 0.0f) ? dMin : dMax) / tanY;
+
+                int x0 = glm::clamp((int)std::floor((ndcXLo * 0.5f + 0.5f) * CLUSTERS_X), 0, CLUSTERS_X - 1);
+                int x1 = glm::clamp((int)std::floor((ndcXHi * 0.5f + 0.5f) * CLUSTERS_X), 0, CLUSTERS_X - 1);
+                int y0 = glm::clamp((int)std::floor((ndcYLo * 0.5f + 0.5f) * CLUSTERS_Y), 0, CLUSTERS_Y - 1);
+                int y1 = glm::clamp((int)std::floor((ndcYHi * 0.5f + 0.5f) * CLUSTERS_Y), 0, CLUSTERS_Y - 1);
+
+                for (int y = y0; y <= y1; y++) {
+                    for (int x = x0; x <= x1; x++) {
+
+                        int cluster = x + CLUSTERS_X * (y + CLUSTERS_Y * z);
+                        const ClusterBounds& bounds = clusterBounds[cluster];
+
+                        // exact sphere vs froxel AABB test
+                        glm::vec3 closest = glm::clamp(center, bounds.min, bounds.max);
+                        glm::vec3 delta = closest - center;
+                        if (glm::dot(delta, delta) > radius * radius)
+                            continue;
+
+                        slicePairs[z].push_back(ClusterLight(cluster, (GLuint)i));
+                    }
+                }
+            }
+        }
+    }
+
+    void LightClusterer::Update(const std::vector<PointLight>& lights, const glm::mat4& viewMatrix, float fovY, float aspect, float nearPlane, float farPlane) {
+
+        if (fovY != this->fovY || aspect != this->aspect || nearPlane != this->nearPlane || farPlane != this->farPlane) {
+
+            this->fovY = fovY;
+            this->aspect = aspect;
+            this->nearPlane = nearPlane;
+            this->farPlane = farPlane;
+            BuildClusterBounds();
+        }
+
+        lightPositions.resize(lights.size());
+        lightRadii.resize(lights.size());
+        lightData.resize(glm::max(lights.size(), (size_t)1) * 2, glm::vec4(0.0f));
+        for (size_t i = 0; i < lights.size(); i++) {
+
+            lightPositions[i] = viewMatrix * glm::vec4(lights[i].position, 1.0f);
+            lightRadii[i] = lights[i].radius;
+            lightData[2 * i] = glm::vec4(glm::vec3(lightPositions[i]), lights[i].radius);
+            lightData[2 * i + 1] = glm::vec4(lights[i].color, 0.0f);
+        }
+
+        // every job owns a contiguous range of depth slices, so no two threads touch the same froxel
+        int jobCount = (lights.size() < 16) ? 1 : jobSystem->GetThreadCount();
+        int slicesPerJob = (CLUSTERS_Z + jobCount - 1) / jobCount;
+        jobSystem->ParallelFor(CLUSTERS_Z, slicesPerJob, [this](int begin, int end) {
+            AssignSlices(begin, end - 1);
+        });
+
+        // count, prefix sum, then fill: every cluster keeps all of its lights, in light order
+        std::fill(clusterCounts.begin(), clusterCounts.end(), 0);
+        for (int z = 0; z < CLUSTERS_Z; z++) {
+            for (size_t p = 0; p < slicePairs[z].size(); p++) {
+                clusterCounts[slicePairs[z][p].first]++;
+            }
+        }
+
+        GLuint offset = 0;
+        for (int c = 0; c < CLUSTER_COUNT; c++) {
+
+            gridData[2 * c] = offset;
+            gridData[2 * c + 1] = (GLuint)clusterCounts[c];
+            offset += (GLuint)clusterCounts[c];
+            // reused as the fill cursor below
+            clusterCounts[c] = (int)gridData[2 * c];
+        }
+
+        indexData.resize(glm::max(offset, (GLuint)1));
+        for (int z = 0; z < CLUSTERS_Z; z++) {
+            for (size_t p = 0; p < slicePairs[z].size(); p++) {
+                indexData[clusterCounts[slicePairs[z][p].first]++] = slicePairs[z][p].second;
+            }
+        }
+
+        glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, lightData.size() * sizeof(glm::vec4), lightData.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, gridData.size() * sizeof(GLuint), gridData.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, indexData.size() * sizeof(GLuint), indexData.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void LightClusterer::Bind(gps::Shader shader, int firstTextureUnit, int viewportWidth, int viewportHeight) {
+
+        shader.useShaderProgram();
+
+        glActiveTexture(GL_TEXTURE0 + firstTextureUnit);
+        glBindTexture(GL_TEXTURE_BUFFER, lightTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, lightBuffer);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "lightData"), firstTextureUnit);
+
+        glActiveTexture(GL_TEXTURE0 + firstTextureUnit + 1);
+        glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, gridBuffer);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "clusterGrid"), firstTextureUnit + 1);
+
+        glActiveTexture(GL_TEXTURE0 + firstTextureUnit + 2);
+        glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, indexBuffer);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "clusterIndices"), firstTextureUnit + 2);
+
+        // slice = floor(log(depth) * scale + bias)
+        float depthScale = CLUSTERS_Z / std::log(farPlane / nearPlane);
+        float depthBias = -CLUSTERS_Z * std::log(nearPlane) / std::log(farPlane / nearPlane);
+
+        glUniform3i(glGetUniformLocation(shader.shaderProgram, "clusterDims"), CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z);
+        glUniform2f(glGetUniformLocation(shader.shaderProgram, "clusterTileScale"),
+            (float)CLUSTERS_X / (float)viewportWidth, (float)CLUSTERS_Y / (float)viewportHeight);
+        glUniform2f(glGetUniformLocation(shader.shaderProgram, "clusterDepthParams"), depthScale, depthBias);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    int LightClusterer::GetLightCount() const {
+
+        return (int)lightPositions.size();
+    }
+}
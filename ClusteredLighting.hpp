@@ -0,0 +1,89 @@
+#ifndef ClusteredLighting_hpp
+#define ClusteredLighting_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "Shader.hpp"
+#include "JobSystem.hpp"
+
+#include <utility>
+#include <vector>
+
+namespace gps {
+
+    struct PointLight {
+        // world space
+        glm::vec3 position;
+        glm::vec3 color;
+        // distance after which the light is ignored, see ComputeLightRadius
+        float radius;
+    };
+
+    // distance at which constant/linear/quadratic attenuation drops the brightest channel below 1/256
+    float ComputeLightRadius(glm::vec3 color, float constant, float linear, float quadratic);
+
+    struct ClusterBounds {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    // Clustered forward shading: the view frustum is split in a froxel grid (screen tiles x
+    // exponential depth slices), each froxel stores the list of lights touching it and the
+    // fragment shader only evaluates the lights of its own froxel.
+    // GL 4.1 has no SSBOs, so lights, grid and index lists are sent as texture buffers.
+    class LightClusterer {
+
+    public:
+        static const int CLUSTERS_X = 16;
+        static const int CLUSTERS_Y = 9;
+        static const int CLUSTERS_Z = 24;
+        static const int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+        void Create(JobSystem& jobSystem);
+        void Delete();
+
+        // assigns the lights to froxels on the job system and uploads the result
+        void Update(const std::vector<PointLight>& lights, const glm::mat4& viewMatrix, float fovY, float aspect, float nearPlane, float farPlane);
+
+        // binds the buffers to firstTextureUnit .. firstTextureUnit + 2 and sets the cluster uniforms
+        void Bind(gps::Shader shader, int firstTextureUnit, int viewportWidth, int viewportHeight);
+
+        int GetLightCount() const;
+
+    private:
+        JobSystem* jobSystem;
+        float fovY = 0.0f, aspect = 0.0f, nearPlane = 0.0f, farPlane = 0.0f;
+        std::vector<ClusterBounds> clusterBounds;
+
+        // view space lights of the current frame
+        std::vector<glm::vec4> lightPositions;
+        std::vector<float> lightRadii;
+
+        // (cluster, light) pairs found in each depth slice; a job only writes the slices it owns,
+        // so the lists need no lock and every cluster's lights come out in light order
+        typedef std::pair<int, GLuint> ClusterLight;
+        std::vector<std::vector<ClusterLight> > slicePairs;
+        std::vector<int> clusterCounts;
+
+        std::vector<GLuint> gridData;
+        std::vector<GLuint> indexData;
+        std::vector<glm::vec4> lightData;
+
+        GLuint lightBuffer, gridBuffer, indexBuffer;
+        GLuint lightTexture, gridTexture, indexTexture;
+
+        void BuildClusterBounds();
+        float SliceDepth(int slice) const;
+        void AssignSlices(int firstSlice, int lastSlice);
+    };
+}
+
+#endif /* ClusteredLighting_hpp */
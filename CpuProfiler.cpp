@@ -0,0 +1,174 @@
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace gps {
+
+    // a full buffer drops further zones of that thread until the capture ends
+    static const int EVENTS_PER_THREAD = 1 << 16;
+
+    struct ProfileEvent {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    struct ThreadBuffer {
+        std::vector<ProfileEvent> events;
+        // written by the owning thread only; the capture that count belongs to is generation
+        std::atomic<int> count;
+        std::atomic<uint32_t> generation;
+        int threadId;
+        std::string name;
+    };
+
+    // buffers are never freed, a thread that exits keeps its events for the trace
+    static std::mutex registryMutex;
+    static std::vector<std::unique_ptr<ThreadBuffer> > registry;
+    static thread_local ThreadBuffer* threadBuffer = NULL;
+
+    static std::atomic<bool> capturing(false);
+    static std::atomic<uint32_t> captureGeneration(0);
+    static std::atomic<uint32_t> droppedEvents(0);
+    static int framesLeft = 0;
+    static uint64_t captureStart = 0;
+    static std::string tracePath;
+
+    static ThreadBuffer* GetThreadBuffer() {
+
+        if (threadBuffer == NULL) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            registry.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+            threadBuffer = registry.back().get();
+            threadBuffer->events.resize(EVENTS_PER_THREAD);
+            threadBuffer->count = 0;
+            threadBuffer->generation = 0;
+            threadBuffer->threadId = (int)registry.size();
+        }
+        return threadBuffer;
+    }
+
+    uint64_t CpuProfiler::Now() {
+
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void CpuProfiler::StartCapture(int frameCount, const std::string& path) {
+
+        if (capturing) {
+            return;
+        }
+        tracePath = path;
+        framesLeft = frameCount > 0 ? frameCount : 1;
+        captureStart = Now();
+        droppedEvents = 0;
+        // the buffers notice the new generation on their next zone and start over
+        captureGeneration++;
+        capturing.store(true, std::memory_order_release);
+    }
+
+    bool CpuProfiler::IsCapturing() {
+
+        return capturing.load(std::memory_order_relaxed);
+    }
+
+    void CpuProfiler::EndFrame() {
+
+        if (!capturing) {
+            return;
+        }
+        if (--framesLeft == 0) {
+            capturing = false;
+            WriteTrace();
+        }
+    }
+
+    void CpuProfiler::SetThreadName(const char* name) {
+
+        ThreadBuffer* buffer = GetThreadBuffer();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer->name = name;
+    }
+
+    void CpuProfiler::Record(const char* name, uint64_t begin, uint64_t end) {
+
+        ThreadBuffer* buffer = GetThreadBuffer();
+
+        uint32_t generation = captureGeneration.load(std::memory_order_acquire);
+        if (buffer->generation.load(std::memory_order_relaxed) != generation) {
+            // count first, so the writer never pairs the new generation with an old count
+            buffer->count.store(0, std::memory_order_relaxed);
+            buffer->generation.store(generation, std::memory_order_release);
+        }
+
+        int count = buffer->count.load(std::memory_order_relaxed);
+        if (count == EVENTS_PER_THREAD) {
+            droppedEvents++;
+            return;
+        }
+        ProfileEvent& event = buffer->events[count];
+        event.name = name;
+        event.begin = begin;
+        event.end = end;
+        // publishes the event to WriteTrace()
+        buffer->count.store(count + 1, std::memory_order_release);
+    }
+
+    void CpuProfiler::WriteTrace() {
+
+        std::ofstream file(tracePath.c_str());
+        if (!file) {
+            std::cerr << "Could not write CPU trace: " << tracePath << std::endl;
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+        uint32_t generation = captureGeneration.load();
+        int written = 0;
+        bool first = true;
+
+        file << "{\"traceEvents\":[\n";
+        file.setf(std::ios::fixed);
+        file.precision(3);
+        for (size_t i = 0; i < registry.size(); i++) {
+
+            ThreadBuffer& buffer = *registry[i];
+            if (buffer.generation.load(std::memory_order_acquire) != generation) {
+                continue;
+            }
+            int count = buffer.count.load(std::memory_order_acquire);
+
+            std::string name = buffer.name.empty() ? "thread " + std::to_string(buffer.threadId) : buffer.name;
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.threadId
+                << ",\"args\":{\"name\":\"" << name << "\"}}";
+            first = false;
+
+            // complete events, timestamps and durations in microseconds from the capture start
+            for (int e = 0; e < count; e++) {
+                const ProfileEvent& event = buffer.events[e];
+                // a zone already open when the capture started (the frame zone) is cut at the start,
+                // the unsigned difference would wrap around
+                uint64_t begin = std::max(event.begin, captureStart);
+                uint64_t end = std::max(event.end, begin);
+                file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.threadId
+                    << ",\"ts\":" << (begin - captureStart) * 1e-3 << ",\"dur\":" << (end - begin) * 1e-3 << "}";
+            }
+            written += count;
+        }
+        file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        std::cout << "CPU trace: " << written << " zones written to " << tracePath;
+        if (droppedEvents > 0) {
+            std::cout << " (" << droppedEvents << " dropped, buffers full)";
+        }
+        std::cout << std::endl;
+    }
+}
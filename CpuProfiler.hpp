@@ -0,0 +1,74 @@
+#ifndef CpuProfiler_hpp
+#define CpuProfiler_hpp
+
+#include <cstdint>
+#include <string>
+
+// The zone macros are compiled in for debug builds; a release build (NDEBUG) drops them unless
+// GPS_CPU_PROFILER is defined.
+#if !defined(NDEBUG) && !defined(GPS_CPU_PROFILER)
+    #define GPS_CPU_PROFILER
+#endif
+
+namespace gps {
+
+    // Records scoped CPU zones of every thread into per-thread buffers while a capture is
+    // running, and writes them as a Chrome trace (chrome://tracing, Perfetto) when it ends.
+    // A thread only ever appends to its own buffer, so recording takes no lock; outside a
+    // capture a zone costs one atomic load.
+    class CpuProfiler {
+
+    public:
+        // records the next frameCount frames, then writes the trace to path
+        static void StartCapture(int frameCount, const std::string& path);
+        static bool IsCapturing();
+        // marks the end of a frame on the main thread, finishes the capture after the last one
+        static void EndFrame();
+
+        // shown as the thread's row name in the trace
+        static void SetThreadName(const char* name);
+
+        // nanoseconds on a steady clock
+        static uint64_t Now();
+        // name must outlive the capture, the macros pass string literals
+        static void Record(const char* name, uint64_t begin, uint64_t end);
+
+    private:
+        static void WriteTrace();
+    };
+
+    class ProfileZone {
+
+    public:
+        explicit ProfileZone(const char* name) : name(name), active(CpuProfiler::IsCapturing()) {
+            if (active) {
+                begin = CpuProfiler::Now();
+            }
+        }
+
+        ~ProfileZone() {
+            if (active) {
+                CpuProfiler::Record(name, begin, CpuProfiler::Now());
+            }
+        }
+
+    private:
+        const char* name;
+        bool active;
+        uint64_t begin;
+    };
+}
+
+#define GPS_PROFILE_CONCAT_(a, b) a##b
+#define GPS_PROFILE_CONCAT(a, b) GPS_PROFILE_CONCAT_(a, b)
+
+#if defined(GPS_CPU_PROFILER)
+    // times the rest of the enclosing scope
+    #define PROFILE_ZONE(name) gps::ProfileZone GPS_PROFILE_CONCAT(profileZone, __LINE__)(name)
+    #define PROFILE_THREAD(name) gps::CpuProfiler::SetThreadName(name)
+#else
+    #define PROFILE_ZONE(name) ((void)0)
+    #define PROFILE_THREAD(name) ((void)0)
+#endif
+
+#endif /* CpuProfiler_hpp */
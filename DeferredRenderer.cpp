@@ -0,0 +1,113 @@
+#include "DeferredRenderer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace gps {
+
+    const int SPHERE_RINGS = 12;
+    const int SPHERE_SEGMENTS = 16;
+
+    void DeferredRenderer::Create() {
+
+        // the fullscreen triangle is generated from gl_VertexID, core profile still needs a VAO bound
+        glGenVertexArrays(1, &fullscreenVAO);
+
+        InitLightVolume();
+    }
+
+    void DeferredRenderer::Delete() {
+
+        glDeleteVertexArrays(1, &fullscreenVAO);
+        glDeleteVertexArrays(1, &sphereVAO);
+        glDeleteBuffers(1, &sphereVBO);
+        glDeleteBuffers(1, &sphereEBO);
+    }
+
+    void DeferredRenderer::InitLightVolume() {
+
+        // faces of a UV sphere lie inside the real sphere, push them out so no lit pixel is missed
+        float scale = 1.0f / std::cos(3.14159265f / SPHERE_SEGMENTS);
+
+        std::vector<glm::vec3> vertices;
+        for (int i = 0; i <= SPHERE_RINGS; i++) {
+
+            float theta = 3.14159265f * i / SPHERE_RINGS;
+            for (int j = 0; j <= SPHERE_SEGMENTS; j++) {
+
+                float phi = 2.0f * 3.14159265f * j / SPHERE_SEGMENTS;
+                vertices.push_back(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)) * scale);
+            }
+        }
+
+        // counter-clockwise seen from outside
+        std::vector<GLuint> indices;
+        for (int i = 0; i < SPHERE_RINGS; i++) {
+            for (int j = 0; j < SPHERE_SEGMENTS; j++) {
+
+                GLuint a = i * (SPHERE_SEGMENTS + 1) + j;
+                GLuint b = a + SPHERE_SEGMENTS + 1;
+                GLuint c = b + 1;
+                GLuint d = a + 1;
+                indices.push_back(a); indices.push_back(c); indices.push_back(b);
+                indices.push_back(a); indices.push_back(d); indices.push_back(c);
+            }
+        }
+        sphereIndexCount = (GLsizei)indices.size();
+
+        glGenVertexArrays(1, &sphereVAO);
+        glGenBuffers(1, &sphereVBO);
+        glGenBuffers(1, &sphereEBO);
+
+        glBindVertexArray(sphereVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLvoid*)0);
+        glBindVertexArray(0);
+    }
+
+    GBufferTargets DeferredRenderer::DeclareGBuffer(RenderGraph& graph, int width, int height) {
+
+        GBufferTargets gBuffer;
+        RenderTargetDesc desc = { width, height, GL_RGBA16F };
+        gBuffer.normal = graph.CreateTexture("gNormal", desc);
+        // sRGB storage keeps the precision where the eye needs it, the encoding is undone on read
+        desc.internalFormat = GL_SRGB8_ALPHA8;
+        gBuffer.albedo = graph.CreateTexture("gAlbedo", desc);
+        desc.internalFormat = GL_RGBA8;
+        gBuffer.specular = graph.CreateTexture("gSpecular", desc);
+        desc.internalFormat = GL_DEPTH_COMPONENT24;
+        gBuffer.depth = graph.CreateTexture("gDepth", desc);
+        return gBuffer;
+    }
+
+    void DeferredRenderer::BindGBuffer(gps::Shader& shader, RenderPassContext& context, const GBufferTargets& gBuffer) {
+
+        shader.useShaderProgram();
+
+        context.BindTexture(shader, "gNormal", gBuffer.normal);
+        context.BindTexture(shader, "gAlbedo", gBuffer.albedo);
+        context.BindTexture(shader, "gSpecular", gBuffer.specular);
+        context.BindTexture(shader, "gDepth", gBuffer.depth);
+    }
+
+    void DeferredRenderer::DrawFullscreenTriangle() {
+
+        glBindVertexArray(fullscreenVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+    }
+
+    void DeferredRenderer::DrawLightVolume() {
+
+        glBindVertexArray(sphereVAO);
+        glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
+}
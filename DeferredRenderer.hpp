@@ -0,0 +1,53 @@
+#ifndef DeferredRenderer_hpp
+#define DeferredRenderer_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "Shader.hpp"
+#include "RenderGraph.hpp"
+
+namespace gps {
+
+    struct GBufferTargets {
+        RenderResource normal;
+        RenderResource albedo;
+        RenderResource specular;
+        RenderResource depth;
+    };
+
+    // G-buffer layout and helper geometry for the deferred render path:
+    // normals (eye space), albedo and specular are written by the geometry pass,
+    // positions are reconstructed from the depth texture by the lighting passes.
+    // The G-buffer textures themselves are transient render graph targets.
+    class DeferredRenderer {
+
+    public:
+        void Create();
+        void Delete();
+
+        // declares the G-buffer textures of this frame in the graph
+        GBufferTargets DeclareGBuffer(RenderGraph& graph, int width, int height);
+
+        // gNormal, gAlbedo, gSpecular and gDepth on texture units handed out by the pass context
+        void BindGBuffer(gps::Shader& shader, RenderPassContext& context, const GBufferTargets& gBuffer);
+
+        void DrawFullscreenTriangle();
+        // unit sphere (slightly enlarged so the faceted mesh contains the real sphere)
+        void DrawLightVolume();
+
+    private:
+        GLuint fullscreenVAO;
+        GLuint sphereVAO, sphereVBO, sphereEBO;
+        GLsizei sphereIndexCount;
+
+        void InitLightVolume();
+    };
+}
+
+#endif /* DeferredRenderer_hpp */
@@ -0,0 +1,143 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace gps {
+
+    // first guess for the sleep overshoot; coarse timers (15.6 ms on a default Windows timer)
+    // raise it after the first frames
+    static const double INITIAL_SPIN_MARGIN_MS = 1.0;
+    static const double MAX_SPIN_MARGIN_MS = 20.0;
+
+    void FramePacer::Create(PresentMode mode, double targetFps) {
+
+        adaptiveSupported = glfwExtensionSupported("WGL_EXT_swap_control_tear")
+            || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+        spinMargin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(INITIAL_SPIN_MARGIN_MS));
+        hasLastFrame = false;
+
+        SetTargetFps(targetFps);
+        SetMode(mode);
+    }
+
+    void FramePacer::SetMode(PresentMode mode) {
+
+        this->mode = mode;
+        switch (mode) {
+        case PRESENT_ADAPTIVE:
+            glfwSwapInterval(adaptiveSupported ? -1 : 1);
+            break;
+        case PRESENT_UNCAPPED:
+        case PRESENT_LIMITED:
+            glfwSwapInterval(0);
+            break;
+        default:
+            glfwSwapInterval(1);
+            break;
+        }
+
+        // the limiter starts counting from now, the statistics from the next frame
+        deadline = Clock::now();
+        ResetStats();
+    }
+
+    PresentMode FramePacer::GetMode() const {
+
+        return mode;
+    }
+
+    void FramePacer::SetTargetFps(double targetFps) {
+
+        targetFps = std::max(targetFps, 1.0);
+        targetInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+    }
+
+    void FramePacer::WaitForDeadline() {
+
+        // the deadlines are a fixed grid, so one long frame does not shift all following ones;
+        // a frame later than a whole interval restarts the grid
+        deadline += targetInterval;
+        Clock::time_point now = Clock::now();
+        if (now > deadline + targetInterval) {
+            deadline = now;
+            return;
+        }
+
+        // sleep while the timer is coarse enough to overshoot, spin the rest
+        Clock::duration sleep = deadline - now - spinMargin;
+        if (sleep > Clock::duration::zero()) {
+            std::this_thread::sleep_for(sleep);
+            Clock::duration overshoot = Clock::now() - (now + sleep);
+            Clock::duration maxMargin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(MAX_SPIN_MARGIN_MS));
+            // rises at once, decays slowly
+            spinMargin = std::min(std::max(overshoot, spinMargin - spinMargin / 64), maxMargin);
+        }
+        while (Clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+
+    void FramePacer::EndFrame() {
+
+        if (mode == PRESENT_LIMITED) {
+            WaitForDeadline();
+        }
+
+        Clock::time_point now = Clock::now();
+        if (hasLastFrame) {
+            intervals.push_back(std::chrono::duration<double, std::milli>(now - lastFrame).count());
+        }
+        lastFrame = now;
+        hasLastFrame = true;
+    }
+
+    FramePacingStats FramePacer::GetStats() const {
+
+        FramePacingStats stats = { 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        stats.frames = (int)intervals.size();
+        if (intervals.empty()) {
+            return stats;
+        }
+
+        double sum = 0.0;
+        stats.min = intervals[0];
+        stats.max = intervals[0];
+        for (size_t i = 0; i < intervals.size(); i++) {
+            sum += intervals[i];
+            stats.min = std::min(stats.min, intervals[i]);
+            stats.max = std::max(stats.max, intervals[i]);
+        }
+        stats.average = sum / intervals.size();
+
+        double variance = 0.0;
+        for (size_t i = 0; i < intervals.size(); i++) {
+            variance += (intervals[i] - stats.average) * (intervals[i] - stats.average);
+        }
+        stats.jitter = std::sqrt(variance / intervals.size());
+
+        std::vector<double> sorted = intervals;
+        size_t p99 = std::min((size_t)(sorted.size() * 0.99), sorted.size() - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+        stats.p99 = sorted[p99];
+        return stats;
+    }
+
+    void FramePacer::ResetStats() {
+
+        intervals.clear();
+        hasLastFrame = false;
+    }
+
+    const char* FramePacer::GetModeName(PresentMode mode) {
+
+        switch (mode) {
+        case PRESENT_VSYNC: return "vsync";
+        case PRESENT_ADAPTIVE: return "adaptive";
+        case PRESENT_UNCAPPED: return "uncapped";
+        case PRESENT_LIMITED: return "limited";
+        default: return "unknown";
+        }
+    }
+}
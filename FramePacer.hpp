@@ -0,0 +1,82 @@
+#ifndef FramePacer_hpp
+#define FramePacer_hpp
+
+#if defined (__APPLE__)
+    #define GLFW_INCLUDE_GLCOREARB
+    #define GL_SILENCE_DEPRECATION
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <vector>
+
+namespace gps {
+
+    enum PresentMode {
+        // swap interval 1
+        PRESENT_VSYNC,
+        // swap interval -1 (EXT_swap_control_tear): a late frame is shown at once instead of
+        // waiting a whole refresh; plain vsync where the extension is missing
+        PRESENT_ADAPTIVE,
+        // swap interval 0, as fast as the GPU goes
+        PRESENT_UNCAPPED,
+        // swap interval 0, the CPU waits out the rest of each target frame time
+        PRESENT_LIMITED,
+        PRESENT_MODE_COUNT
+    };
+
+    // over the frame to frame intervals since the last ResetStats(), in milliseconds
+    struct FramePacingStats {
+        int frames;
+        double average;
+        double min;
+        double max;
+        double p99;
+        // standard deviation of the interval
+        double jitter;
+    };
+
+    // Owns the swap interval and the frame limiter, and records when every frame ends.
+    class FramePacer {
+
+    public:
+        // the window's context must be current
+        void Create(PresentMode mode, double targetFps);
+
+        void SetMode(PresentMode mode);
+        PresentMode GetMode() const;
+        // frame rate of PRESENT_LIMITED
+        void SetTargetFps(double targetFps);
+
+        // right after the buffer swap: waits for the limiter, then timestamps the frame
+        void EndFrame();
+
+        FramePacingStats GetStats() const;
+        void ResetStats();
+
+        static const char* GetModeName(PresentMode mode);
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        PresentMode mode;
+        bool adaptiveSupported;
+
+        Clock::duration targetInterval;
+        Clock::time_point deadline;
+        // how much longer than asked sleep_for() takes here, the last part is spun instead
+        Clock::duration spinMargin;
+
+        Clock::time_point lastFrame;
+        bool hasLastFrame;
+        std::vector<double> intervals;
+
+        void WaitForDeadline();
+    };
+}
+
+#endif /* FramePacer_hpp */
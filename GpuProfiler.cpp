@@ -0,0 +1,180 @@
+#include "GpuProfiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+namespace gps {
+
+    void GpuProfiler::Create(int historyFrames) {
+
+        this->historyFrames = std::max(historyFrames, 1);
+        frameIndex = 0;
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            glGenQueries(MAX_ZONES * 2, frames[i].queries);
+            frames[i].zoneCount = 0;
+            frames[i].recorded = false;
+        }
+        created = true;
+    }
+
+    void GpuProfiler::Delete() {
+
+        if (!created) {
+            return;
+        }
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            glDeleteQueries(MAX_ZONES * 2, frames[i].queries);
+        }
+        created = false;
+    }
+
+    int GpuProfiler::GetZone(const std::string& name) {
+
+        std::map<std::string, int>::iterator found = zoneIndices.find(name);
+        if (found != zoneIndices.end()) {
+            return found->second;
+        }
+
+        ZoneHistory zone;
+        zone.name = name;
+        zone.next = 0;
+        zone.last = 0.0;
+        zones.push_back(zone);
+        zoneIndices[name] = (int)zones.size() - 1;
+        return (int)zones.size() - 1;
+    }
+
+    void GpuProfiler::Collect(FrameQueries& frame) {
+
+        if (!frame.recorded || frame.zoneCount == 0) {
+            return;
+        }
+
+        // nested zones end out of slot order, so every end timestamp is checked
+        for (int i = 0; i < frame.zoneCount; i++) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(frame.queries[i * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                return;
+            }
+        }
+
+        for (int i = 0; i < frame.zoneCount; i++) {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+            double milliseconds = end > begin ? (end - begin) * 1e-6 : 0.0;
+
+            ZoneHistory& zone = zones[frame.zones[i]];
+            if ((int)zone.samples.size() < historyFrames) {
+                zone.samples.push_back(milliseconds);
+            }
+            else {
+                zone.samples[zone.next] = milliseconds;
+                zone.next = (zone.next + 1) % historyFrames;
+            }
+            zone.last = milliseconds;
+        }
+    }
+
+    void GpuProfiler::BeginFrame() {
+
+        frameIndex = (frameIndex + 1) % FRAMES_IN_FLIGHT;
+        FrameQueries& frame = frames[frameIndex];
+        Collect(frame);
+
+        frame.zoneCount = 0;
+        frame.recorded = false;
+        openZones.clear();
+    }
+
+    void GpuProfiler::EndFrame() {
+
+        // zones left open would never get their end timestamp
+        while (!openZones.empty()) {
+            End();
+        }
+        frames[frameIndex].recorded = true;
+    }
+
+    void GpuProfiler::Begin(const std::string& name) {
+
+        FrameQueries& frame = frames[frameIndex];
+        int zone = GetZone(name);
+        if (frame.zoneCount == MAX_ZONES) {
+            // still balanced with End(), but not recorded
+            openZones.push_back(-1);
+            return;
+        }
+
+        int slot = frame.zoneCount++;
+        frame.zones[slot] = zone;
+        glQueryCounter(frame.queries[slot * 2], GL_TIMESTAMP);
+        openZones.push_back(slot);
+    }
+
+    void GpuProfiler::End() {
+
+        if (openZones.empty()) {
+            return;
+        }
+        int slot = openZones.back();
+        openZones.pop_back();
+        if (slot >= 0) {
+            glQueryCounter(frames[frameIndex].queries[slot * 2 + 1], GL_TIMESTAMP);
+        }
+    }
+
+    std::vector<GpuZoneStats> GpuProfiler::GetStats() const {
+
+        std::vector<GpuZoneStats> stats;
+        for (size_t i = 0; i < zones.size(); i++) {
+            const ZoneHistory& zone = zones[i];
+
+            GpuZoneStats zoneStats = { zone.name, (int)zone.samples.size(), 0.0, 0.0, 0.0, zone.last };
+            if (!zone.samples.empty()) {
+                std::vector<double> sorted = zone.samples;
+                std::sort(sorted.begin(), sorted.end());
+                double sum = 0.0;
+                for (size_t s = 0; s < sorted.size(); s++) {
+                    sum += sorted[s];
+                }
+                zoneStats.min = sorted.front();
+                zoneStats.average = sum / sorted.size();
+                zoneStats.p99 = sorted[std::min((size_t)(sorted.size() * 0.99), sorted.size() - 1)];
+            }
+            stats.push_back(zoneStats);
+        }
+        return stats;
+    }
+
+    bool GpuProfiler::WriteReport(const std::string& path) const {
+
+        std::ofstream file(path.c_str());
+        if (!file) {
+            return false;
+        }
+
+        std::vector<GpuZoneStats> stats = GetStats();
+        bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+
+        if (json) {
+            file << "{\n  \"unit\": \"ms\",\n  \"zones\": [\n";
+            for (size_t i = 0; i < stats.size(); i++) {
+                file << "    { \"name\": \"" << stats[i].name << "\", \"samples\": " << stats[i].samples
+                    << ", \"min\": " << stats[i].min << ", \"avg\": " << stats[i].average
+                    << ", \"p99\": " << stats[i].p99 << ", \"last\": " << stats[i].last << " }"
+                    << (i + 1 < stats.size() ? "," : "") << "\n";
+            }
+            file << "  ]\n}\n";
+        }
+        else {
+            file << "zone,samples,min_ms,avg_ms,p99_ms,last_ms\n";
+            for (size_t i = 0; i < stats.size(); i++) {
+                file << stats[i].name << "," << stats[i].samples << "," << stats[i].min << ","
+                    << stats[i].average << "," << stats[i].p99 << "," << stats[i].last << "\n";
+            }
+        }
+        return (bool)file;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef GpuProfiler_hpp
+#define GpuProfiler_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // rolling statistics of one zone, in milliseconds
+    struct GpuZoneStats {
+        std::string name;
+        int samples;
+        double min;
+        double average;
+        double p99;
+        double last;
+    };
+
+    // GPU time of named zones (the render graph passes, the whole frame) from GL_TIMESTAMP
+    // queries. Every frame writes into its own set of queries, and a set is only read back when
+    // it comes around again FRAMES_IN_FLIGHT frames later; results that are still not available
+    // then are dropped, so the profiler never waits for the GPU.
+    class GpuProfiler {
+
+    public:
+        // statistics cover the last historyFrames samples of every zone
+        void Create(int historyFrames = 600);
+        void Delete();
+
+        // collects the oldest set of queries, then starts recording into it
+        void BeginFrame();
+        void EndFrame();
+
+        // zones may nest; End() closes the innermost open one
+        void Begin(const std::string& name);
+        void End();
+
+        // in the order the zones were first seen
+        std::vector<GpuZoneStats> GetStats() const;
+        // .json writes a JSON object, any other extension CSV
+        bool WriteReport(const std::string& path) const;
+
+    private:
+        static const int FRAMES_IN_FLIGHT = 4;
+        static const int MAX_ZONES = 64;
+
+        struct FrameQueries {
+            // begin and end timestamp of every zone
+            GLuint queries[MAX_ZONES * 2];
+            int zones[MAX_ZONES];
+            int zoneCount;
+            bool recorded;
+        };
+
+        struct ZoneHistory {
+            std::string name;
+            // ring of the last historyFrames durations
+            std::vector<double> samples;
+            int next;
+            double last;
+        };
+
+        FrameQueries frames[FRAMES_IN_FLIGHT];
+        int frameIndex;
+        int historyFrames;
+        bool created = false;
+
+        std::vector<ZoneHistory> zones;
+        std::map<std::string, int> zoneIndices;
+        // zone slots of the current frame that are still open
+        std::vector<int> openZones;
+
+        void Collect(FrameQueries& frame);
+        int GetZone(const std::string& name);
+    };
+}
+
+#endif /* GpuProfiler_hpp */
@@ -0,0 +1,106 @@
+#include "GpuSnow.hpp"
+
+#include <cstddef>
+
+namespace gps {
+
+    void GpuSnow::Create(int particleCount) {
+
+        this->particleCount = particleCount;
+        current = 0;
+        frame = 0;
+
+        glGenBuffers(2, buffers);
+        glGenVertexArrays(2, updateVAO);
+        glGenVertexArrays(2, renderVAO);
+
+        // zeroed particles, the first Update() spawns all of them
+        std::vector<GpuSnowParticle> particles(particleCount, GpuSnowParticle());
+        GLsizei stride = sizeof(GpuSnowParticle);
+
+        for (int i = 0; i < 2; i++) {
+
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+            glBufferData(GL_ARRAY_BUFFER, particles.size() * sizeof(GpuSnowParticle), particles.data(), GL_DYNAMIC_COPY);
+
+            glBindVertexArray(updateVAO[i]);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(GpuSnowParticle, position));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(GpuSnowParticle, velocity));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(GpuSnowParticle, size));
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(GpuSnowParticle, lifetime));
+
+            glBindVertexArray(renderVAO[i]);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(GpuSnowParticle, position));
+            glVertexAttribDivisor(0, 1);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(GpuSnowParticle, size));
+            glVertexAttribDivisor(1, 1);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void GpuSnow::Delete() {
+
+        glDeleteVertexArrays(2, updateVAO);
+        glDeleteVertexArrays(2, renderVAO);
+        glDeleteBuffers(2, buffers);
+    }
+
+    std::vector<const GLchar*> GpuSnow::GetFeedbackVaryings() {
+
+        std::vector<const GLchar*> varyings;
+        varyings.push_back("tfPosition");
+        varyings.push_back("tfVelocity");
+        varyings.push_back("tfSize");
+        varyings.push_back("tfLifetime");
+        return varyings;
+    }
+
+    void GpuSnow::Update(gps::Shader& updateShader, float deltaTime, glm::vec3 volumeMin, glm::vec3 volumeSize, const gps::Heightfield& surface) {
+
+        int next = 1 - current;
+
+        updateShader.useShaderProgram();
+        glUniform1f(glGetUniformLocation(updateShader.shaderProgram, "deltaTime"), deltaTime);
+        glUniform1ui(glGetUniformLocation(updateShader.shaderProgram, "seed"), frame);
+        glUniform1i(glGetUniformLocation(updateShader.shaderProgram, "initialize"), frame == 0);
+        glUniform3fv(glGetUniformLocation(updateShader.shaderProgram, "volumeMin"), 1, &volumeMin[0]);
+        glUniform3fv(glGetUniformLocation(updateShader.shaderProgram, "volumeSize"), 1, &volumeSize[0]);
+        // runs outside the render graph, no other texture is bound for this draw
+        surface.Bind(updateShader, 0);
+
+        // vertex processing only, nothing is rasterized
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(updateVAO[current]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[next]);
+
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, particleCount);
+        glEndTransformFeedback();
+
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glBindVertexArray(0);
+        glDisable(GL_RASTERIZER_DISCARD);
+
+        current = next;
+        frame++;
+    }
+
+    void GpuSnow::Draw() {
+
+        glBindVertexArray(renderVAO[current]);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, particleCount);
+        glBindVertexArray(0);
+    }
+
+    int GpuSnow::GetParticleCount() const {
+
+        return particleCount;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef GpuSnow_hpp
+#define GpuSnow_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "Shader.hpp"
+#include "Heightfield.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    // vertex layout of snowUpdate.vert
+    struct GpuSnowParticle {
+        glm::vec3 position;
+        glm::vec3 velocity;
+        float size;
+        float lifetime;
+    };
+
+    // GPU resident snow: the particles live in two VBOs, every Update() runs snowUpdate.vert
+    // over one of them and captures the result into the other with transform feedback,
+    // so no particle data crosses the bus after Create(). Like SnowSimulation, the particles
+    // wrap around a box that follows the camera and restart at its top when they land on the surface.
+    class GpuSnow {
+
+    public:
+        void Create(int particleCount);
+        void Delete();
+
+        // names of the captured outputs of snowUpdate.vert, in buffer order
+        static std::vector<const GLchar*> GetFeedbackVaryings();
+
+        void Update(gps::Shader& updateShader, float deltaTime, glm::vec3 volumeMin, glm::vec3 volumeSize, const gps::Heightfield& surface);
+        // one instanced quad (4 vertex triangle strip) per particle from the latest buffer,
+        // position on attribute 0 and size on attribute 1, both per instance
+        void Draw();
+
+        int GetParticleCount() const;
+
+    private:
+        int particleCount;
+        int current;
+        unsigned int frame;
+
+        GLuint buffers[2];
+        GLuint updateVAO[2];
+        GLuint renderVAO[2];
+    };
+}
+
+#endif /* GpuSnow_hpp */
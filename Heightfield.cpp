@@ -0,0 +1,153 @@
+#include "Heightfield.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gps {
+
+    // keeps the texture and the CPU copy of a large terrain reasonable
+    static const int MAX_RESOLUTION = 2048;
+
+    void Heightfield::Create(glm::vec2 min, glm::vec2 max, float cellSize, float floorHeight) {
+
+        glm::vec2 size = max - min;
+        cellSize = std::max(cellSize, std::max(size.x, size.y) / MAX_RESOLUTION);
+
+        this->min = min;
+        this->cellSize = cellSize;
+        this->floorHeight = floorHeight;
+        width = std::max((int)std::ceil(size.x / cellSize), 1);
+        depth = std::max((int)std::ceil(size.y / cellSize), 1);
+        heights.assign(width * depth, floorHeight);
+    }
+
+    void Heightfield::Delete() {
+
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+
+    void Heightfield::AddModel(const gps::Model3D& model, const glm::mat4& modelMatrix) {
+
+        if (heights.empty()) {
+            return;
+        }
+        const std::vector<gps::Mesh>& meshes = model.GetMeshes();
+        std::vector<glm::vec3> positions;
+
+        for (size_t m = 0; m < meshes.size(); m++) {
+
+            const gps::Mesh& mesh = meshes[m];
+            positions.resize(mesh.vertices.size());
+            for (size_t i = 0; i < mesh.vertices.size(); i++) {
+                positions[i] = glm::vec3(modelMatrix * glm::vec4(mesh.vertices[i].Position, 1.0f));
+            }
+
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                Raster(positions[mesh.indices[i]], positions[mesh.indices[i + 1]], positions[mesh.indices[i + 2]]);
+            }
+        }
+    }
+
+    void Heightfield::Splat(const glm::vec3& p) {
+
+        int x = (int)std::floor((p.x - min.x) / cellSize);
+        int z = (int)std::floor((p.z - min.y) / cellSize);
+        if (x < 0 || z < 0 || x >= width || z >= depth) {
+            return;
+        }
+        float& height = heights[z * width + x];
+        height = std::max(height, p.y);
+    }
+
+    void Heightfield::Raster(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+
+        // walls and thin parts cover no cell center, their corners still mark the cells they touch
+        Splat(a);
+        Splat(b);
+        Splat(c);
+
+        float area = (b.x - a.x) * (c.z - a.z) - (c.x - a.x) * (b.z - a.z);
+        if (std::fabs(area) < 1e-8f) {
+            return;
+        }
+
+        // cell centers inside the triangle's xz bounding box
+        int x0 = std::max((int)std::ceil((std::min(a.x, std::min(b.x, c.x)) - min.x) / cellSize - 0.5f), 0);
+        int x1 = std::min((int)std::floor((std::max(a.x, std::max(b.x, c.x)) - min.x) / cellSize - 0.5f), width - 1);
+        int z0 = std::max((int)std::ceil((std::min(a.z, std::min(b.z, c.z)) - min.y) / cellSize - 0.5f), 0);
+        int z1 = std::min((int)std::floor((std::max(a.z, std::max(b.z, c.z)) - min.y) / cellSize - 0.5f), depth - 1);
+
+        float invArea = 1.0f / area;
+        for (int z = z0; z <= z1; z++) {
+            float pz = min.y + (z + 0.5f) * cellSize;
+            for (int x = x0; x <= x1; x++) {
+                float px = min.x + (x + 0.5f) * cellSize;
+
+                // barycentric coordinates in the xz plane
+                float wa = ((b.x - px) * (c.z - pz) - (c.x - px) * (b.z - pz)) * invArea;
+                float wb = ((c.x - px) * (a.z - pz) - (a.x - px) * (c.z - pz)) * invArea;
+                float wc = 1.0f - wa - wb;
+                if (wa < 0.0f || wb < 0.0f || wc < 0.0f) {
+                    continue;
+                }
+
+                float& height = heights[z * width + x];
+                height = std::max(height, wa * a.y + wb * b.y + wc * c.y);
+            }
+        }
+    }
+
+    void Heightfield::CreateTexture() {
+
+        if (texture == 0) {
+            glGenTextures(1, &texture);
+        }
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, depth, 0, GL_RED, GL_FLOAT, heights.data());
+        // linear filtering is the same bilinear lookup as GetHeight()
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    float Heightfield::GetCell(int x, int z) const {
+
+        x = std::min(std::max(x, 0), width - 1);
+        z = std::min(std::max(z, 0), depth - 1);
+        return heights[z * width + x];
+    }
+
+    float Heightfield::GetHeight(float x, float z) const {
+
+        float u = (x - min.x) / cellSize;
+        float v = (z - min.y) / cellSize;
+        if (heights.empty() || u < 0.0f || v < 0.0f || u > width || v > depth) {
+            return floorHeight;
+        }
+
+        // the samples sit at the cell centers
+        u -= 0.5f;
+        v -= 0.5f;
+        int x0 = (int)std::floor(u);
+        int z0 = (int)std::floor(v);
+        float fx = u - x0;
+        float fz = v - z0;
+
+        float h0 = GetCell(x0, z0) + (GetCell(x0 + 1, z0) - GetCell(x0, z0)) * fx;
+        float h1 = GetCell(x0, z0 + 1) + (GetCell(x0 + 1, z0 + 1) - GetCell(x0, z0 + 1)) * fx;
+        return h0 + (h1 - h0) * fz;
+    }
+
+    void Heightfield::Bind(gps::Shader& shader, int textureUnit) const {
+
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "heightfield"), textureUnit);
+        glUniform2f(glGetUniformLocation(shader.shaderProgram, "heightfieldMin"), min.x, min.y);
+        glUniform2f(glGetUniformLocation(shader.shaderProgram, "heightfieldSize"), width * cellSize, depth * cellSize);
+        glUniform1f(glGetUniformLocation(shader.shaderProgram, "heightfieldFloor"), floorHeight);
+    }
+}
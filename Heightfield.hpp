@@ -0,0 +1,58 @@
+#ifndef Heightfield_hpp
+#define Heightfield_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "Model3D.hpp"
+#include "Shader.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    // Top-down max-height raster of static geometry on a regular grid over the xz plane.
+    // Baked once; ground queries are then a bilinear lookup instead of a ray test, on the CPU
+    // with GetHeight() and on the GPU through an R32F texture.
+    class Heightfield {
+
+    public:
+        // covers [min.x, max.x] x [min.y, max.y] of the xz plane; cells nothing was rasterized
+        // into, and every query outside the grid, return floorHeight
+        void Create(glm::vec2 min, glm::vec2 max, float cellSize, float floorHeight);
+        void Delete();
+
+        // rasterizes every triangle of the model, keeping the highest surface of each cell
+        void AddModel(const gps::Model3D& model, const glm::mat4& modelMatrix);
+        // uploads the heights, after the last AddModel()
+        void CreateTexture();
+
+        float GetHeight(float x, float z) const;
+
+        // the texture on textureUnit and the uniforms heightfield, heightfieldMin,
+        // heightfieldSize and heightfieldFloor
+        void Bind(gps::Shader& shader, int textureUnit) const;
+
+    private:
+        // until Create() the field is empty: AddModel() does nothing, GetHeight() returns floorHeight
+        glm::vec2 min = glm::vec2(0.0f);
+        float cellSize = 1.0f;
+        int width = 0, depth = 0;
+        float floorHeight = 0.0f;
+        std::vector<float> heights;
+        GLuint texture = 0;
+
+        void Raster(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+        void Splat(const glm::vec3& p);
+        float GetCell(int x, int z) const;
+    };
+}
+
+#endif /* Heightfield_hpp */
@@ -0,0 +1,36 @@
+#include "InputQueue.hpp"
+
+namespace gps {
+
+    bool InputQueue::Push(const InputEvent& event) {
+
+        uint32_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) == CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        events[currentTail % CAPACITY] = event;
+        // publishes the event to Pop()
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool InputQueue::Pop(InputEvent& event) {
+
+        uint32_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        event = events[currentHead % CAPACITY];
+        // hands the slot back to Push()
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t InputQueue::GetDroppedCount() const {
+
+        return dropped.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef InputQueue_hpp
+#define InputQueue_hpp
+
+#include <atomic>
+#include <cstdint>
+
+namespace gps {
+
+    enum InputEventType {
+        INPUT_KEY,
+        INPUT_MOUSE_MOVE,
+        INPUT_MOUSE_BUTTON
+    };
+
+    struct InputEvent {
+        InputEventType type;
+        // glfwGetTime() when the callback ran
+        double time;
+        // key or mouse button, and GLFW_PRESS / GLFW_RELEASE / GLFW_REPEAT
+        int code;
+        int action;
+        // cursor position of INPUT_MOUSE_MOVE
+        double x;
+        double y;
+    };
+
+    // Single producer, single consumer ring of input events: the GLFW callbacks push, the
+    // frame drains it at fixed points. Neither side takes a lock, so a callback never waits
+    // on the frame and the frame decides when input is applied.
+    class InputQueue {
+
+    public:
+        // false when the queue is full; the event is dropped and counted
+        bool Push(const InputEvent& event);
+        bool Pop(InputEvent& event);
+
+        uint32_t GetDroppedCount() const;
+
+    private:
+        static const uint32_t CAPACITY = 1024;
+
+        InputEvent events[CAPACITY];
+        // head: next slot to read, tail: next slot to write; both only grow
+        std::atomic<uint32_t> head{ 0 };
+        std::atomic<uint32_t> tail{ 0 };
+        std::atomic<uint32_t> dropped{ 0 };
+    };
+}
+
+#endif /* InputQueue_hpp */
@@ -0,0 +1,177 @@
+#include "JobSystem.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace gps {
+
+    // queue of the current thread, 0 for the thread that created the system
+    static thread_local int currentQueue = 0;
+
+    // rounds a worker spins looking for work before it goes to sleep
+    const int SPIN_ROUNDS = 64;
+
+    void JobSystem::Create(int workerCount) {
+
+        if (workerCount <= 0)
+            workerCount = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+
+        running = true;
+        queuedJobs = 0;
+
+        queues.clear();
+        for (int i = 0; i <= workerCount; i++) {
+            queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+        }
+
+        currentQueue = 0;
+        for (int i = 1; i <= workerCount; i++) {
+            workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+        }
+    }
+
+    void JobSystem::Delete() {
+
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            running = false;
+        }
+        wakeUp.notify_all();
+
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        workers.clear();
+        queues.clear();
+    }
+
+    void JobSystem::Run(const std::function<void()>& job, JobCounter& counter) {
+
+        counter++;
+
+        // not created yet - behave like a plain function call
+        if (queues.empty()) {
+            job();
+            counter--;
+            return;
+        }
+
+        Job entry;
+        entry.function = job;
+        entry.counter = &counter;
+        {
+            WorkQueue& queue = *queues[currentQueue];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(entry);
+        }
+        queuedJobs++;
+
+        // taking the lock orders the push before a worker's check of queuedJobs
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        wakeUp.notify_one();
+    }
+
+    bool JobSystem::Pop(int queue, Job& job) {
+
+        WorkQueue& q = *queues[queue];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.jobs.empty())
+            return false;
+
+        // newest first - its data is most likely still in this core's cache
+        job = q.jobs.back();
+        q.jobs.pop_back();
+        return true;
+    }
+
+    bool JobSystem::Steal(int thief, Job& job) {
+
+        int count = (int)queues.size();
+        for (int i = 1; i < count; i++) {
+
+            WorkQueue& q = *queues[(thief + i) % count];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.jobs.empty())
+                continue;
+
+            // oldest first - usually the biggest remaining piece of work
+            job = q.jobs.front();
+            q.jobs.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    bool JobSystem::ExecuteOne(int queue) {
+
+        Job job;
+        if (!Pop(queue, job) && !Steal(queue, job))
+            return false;
+
+        queuedJobs--;
+        {
+            PROFILE_ZONE("job");
+            job.function();
+        }
+        (*job.counter)--;
+        return true;
+    }
+
+    void JobSystem::WorkerLoop(int queue) {
+
+        currentQueue = queue;
+        PROFILE_THREAD(("worker " + std::to_string(queue)).c_str());
+
+        while (running) {
+
+            bool worked = false;
+            for (int i = 0; i < SPIN_ROUNDS && !worked; i++) {
+                worked = ExecuteOne(queue);
+                if (!worked)
+                    std::this_thread::yield();
+            }
+            if (worked)
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this] { return !running || queuedJobs > 0; });
+        }
+    }
+
+    void JobSystem::Wait(JobCounter& counter) {
+
+        while (counter > 0) {
+            if (queues.empty() || !ExecuteOne(currentQueue))
+                std::this_thread::yield();
+        }
+    }
+
+    void JobSystem::ParallelFor(int count, int batchSize, const std::function<void(int, int)>& body) {
+
+        if (count <= 0)
+            return;
+
+        batchSize = std::max(batchSize, 1);
+        if (count <= batchSize) {
+            body(0, count);
+            return;
+        }
+
+        JobCounter counter(0);
+        // the calling thread takes the first batch itself
+        for (int begin = batchSize; begin < count; begin += batchSize) {
+            int end = std::min(begin + batchSize, count);
+            Run([&body, begin, end] { body(begin, end); }, counter);
+        }
+        body(0, batchSize);
+        Wait(counter);
+    }
+
+    int JobSystem::GetThreadCount() const {
+
+        return std::max((int)queues.size(), 1);
+    }
+}
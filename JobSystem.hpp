@@ -0,0 +1,63 @@
+#ifndef JobSystem_hpp
+#define JobSystem_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gps {
+
+    // number of unfinished jobs of a batch, Wait() returns once it reaches zero
+    typedef std::atomic<int> JobCounter;
+
+    // Work-stealing job system: every thread (the calling thread included) owns a queue,
+    // pushes and pops its own jobs at the back and steals from the front of the others
+    // when it runs dry. Waiting threads keep executing jobs instead of blocking.
+    class JobSystem {
+
+    public:
+        // workerCount <= 0 uses one worker per hardware thread besides the calling one
+        void Create(int workerCount = 0);
+        void Delete();
+
+        void Run(const std::function<void()>& job, JobCounter& counter);
+        void Wait(JobCounter& counter);
+
+        // splits [0, count) in batches of batchSize and runs body(begin, end) on them in parallel
+        void ParallelFor(int count, int batchSize, const std::function<void(int, int)>& body);
+
+        // workers + the thread that created the system
+        int GetThreadCount() const;
+
+    private:
+        struct Job {
+            std::function<void()> function;
+            JobCounter* counter;
+        };
+
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<WorkQueue> > queues;
+
+        std::atomic<bool> running;
+        std::atomic<int> queuedJobs;
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp;
+
+        bool Pop(int queue, Job& job);
+        bool Steal(int thief, Job& job);
+        bool ExecuteOne(int queue);
+        void WorkerLoop(int queue);
+    };
+}
+
+#endif /* JobSystem_hpp */
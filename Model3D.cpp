@@ -20,10 +20,39 @@ namespace gps {
 			meshes[i].Draw(shaderProgram);
 	}
 
+	glm::vec3 Model3D::GetBoundsMin() const {
+
+		return boundsMin;
+	}
+
+	glm::vec3 Model3D::GetBoundsMax() const {
+
+		return boundsMax;
+	}
+
+	const std::vector<gps::Mesh>& Model3D::GetMeshes() const {
+
+		return meshes;
+	}
+
+	const gps::TriangleBvh& Model3D::GetBvh() {
+
+		if (!bvh.IsBuilt()) {
+			bvh.Build(meshes);
+		}
+		return bvh;
+	}
+
+	const std::string& Model3D::GetFileName() const {
+
+		return fileName;
+	}
+
 	// Does the parsing of the .obj file and fills in the data structure
 	void Model3D::ReadOBJ(std::string fileName, std::string basePath) {
 
         std::cout << "Loading : " << fileName << std::endl;
+		this->fileName = fileName;
 		tinyobj::attrib_t attrib;
 		std::vector<tinyobj::shape_t> shapes;
 		std::vector<tinyobj::material_t> materials;
@@ -46,6 +75,8 @@ namespace gps {
 		std::cout << "# of shapes    : " << shapes.size() << std::endl;
 		std::cout << "# of materials : " << materials.size() << std::endl;
 
+		bool firstVertex = true;
+
 		// Loop over shapes
 		for (size_t s = 0; s < shapes.size(); s++) {
 
@@ -87,6 +118,14 @@ namespace gps {
 					glm::vec3 vertexNormal(nx, ny, nz);
 					glm::vec2 vertexTexCoords(tx, ty);
 
+					if (firstVertex) {
+
+						boundsMin = boundsMax = vertexPosition;
+						firstVertex = false;
+					}
+					boundsMin = glm::min(boundsMin, vertexPosition);
+					boundsMax = glm::max(boundsMax, vertexPosition);
+
 					gps::Vertex currentVertex;
 					currentVertex.Position = vertexPosition;
 					currentVertex.Normal = vertexNormal;
@@ -2,6 +2,7 @@
 #define Model3D_hpp
 
 #include "Mesh.hpp"
+#include "Bvh.hpp"
 
 #include "tiny_obj_loader.h"
 #include "stb_image.h"
@@ -23,11 +24,28 @@ namespace gps {
 
 		void Draw(gps::Shader shaderProgram);
 
+		// Object space axis aligned bounding box of all meshes
+		glm::vec3 GetBoundsMin() const;
+		glm::vec3 GetBoundsMax() const;
+
+		// CPU copy of the geometry, for baking and collision queries
+		const std::vector<gps::Mesh>& GetMeshes() const;
+
+		// Triangle BVH of the meshes, built on first use
+		const gps::TriangleBvh& GetBvh();
+
+		const std::string& GetFileName() const;
+
     private:
 		// Component meshes - group of objects
         std::vector<gps::Mesh> meshes;
 		// Associated textures
         std::vector<gps::Texture> loadedTextures;
+		// Bounding box, filled in while reading the .obj file
+		glm::vec3 boundsMin = glm::vec3(0.0f);
+		glm::vec3 boundsMax = glm::vec3(0.0f);
+		gps::TriangleBvh bvh;
+		std::string fileName;
 
 		// Does the parsing of the .obj file and fills in the data structure
 		void ReadOBJ(std::string fileName, std::string basePath);
@@ -0,0 +1,283 @@
+#include "ParticleSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace gps {
+
+    void IntegrateParticles(ParticlePool& pool, const EmitterDesc& emitter, float deltaTime) {
+
+        float* __restrict px = pool.positionX.data();
+        float* __restrict py = pool.positionY.data();
+        float* __restrict pz = pool.positionZ.data();
+        float* __restrict vx = pool.velocityX.data();
+        float* __restrict vy = pool.velocityY.data();
+        float* __restrict vz = pool.velocityZ.data();
+        float* __restrict size = pool.size.data();
+
+        glm::vec3 acceleration = emitter.acceleration * deltaTime;
+        float damping = std::max(1.0f - emitter.drag * deltaTime, 0.0f);
+        float growth = emitter.sizeGrowth * deltaTime;
+
+        for (int i = 0; i < pool.alive; i++) {
+            vx[i] = (vx[i] + acceleration.x) * damping;
+            vy[i] = (vy[i] + acceleration.y) * damping;
+            vz[i] = (vz[i] + acceleration.z) * damping;
+            px[i] += vx[i] * deltaTime;
+            py[i] += vy[i] * deltaTime;
+            pz[i] += vz[i] * deltaTime;
+            size[i] = std::max(size[i] + growth, 0.0f);
+        }
+    }
+
+    void ParticleSystem::Create(const EmitterDesc& emitter, int capacity, ParticleKernel kernel, uint64_t seed) {
+
+        this->emitter = emitter;
+        this->kernel = kernel;
+        emitAccumulator = 0.0f;
+        rng.Seed(seed);
+
+        pool.capacity = capacity;
+        pool.alive = 0;
+        pool.positionX.resize(capacity); pool.positionY.resize(capacity); pool.positionZ.resize(capacity);
+        pool.velocityX.resize(capacity); pool.velocityY.resize(capacity); pool.velocityZ.resize(capacity);
+        pool.size.resize(capacity);
+        pool.age.resize(capacity);
+        pool.lifetime.resize(capacity);
+
+        sortKeys.resize(capacity); sortIndices.resize(capacity);
+        sortKeysTemp.resize(capacity); sortIndicesTemp.resize(capacity);
+    }
+
+    EmitterDesc& ParticleSystem::GetEmitter() {
+
+        return emitter;
+    }
+
+    void ParticleSystem::Emit(int count) {
+
+        // a full pool drops the new particles instead of growing
+        count = std::min(count, pool.capacity - pool.alive);
+
+        for (int n = 0; n < count; n++) {
+
+            glm::vec3 offset(0.0f);
+            switch (emitter.shape) {
+            case EMITTER_SPHERE:
+                do {
+                    offset = glm::vec3(rng.NextFloat(-1.0f, 1.0f), rng.NextFloat(-1.0f, 1.0f), rng.NextFloat(-1.0f, 1.0f));
+                } while (glm::dot(offset, offset) > 1.0f);
+                offset *= emitter.extents.x;
+                break;
+            case EMITTER_BOX:
+                offset = glm::vec3(rng.NextFloat(-1.0f, 1.0f), rng.NextFloat(-1.0f, 1.0f), rng.NextFloat(-1.0f, 1.0f)) * emitter.extents;
+                break;
+            case EMITTER_DISC: {
+                // sqrt keeps the density uniform over the area
+                float radius = std::sqrt(rng.NextFloat()) * emitter.extents.x;
+                float angle = rng.NextFloat() * 6.2831853f;
+                offset = glm::vec3(std::cos(angle) * radius, 0.0f, std::sin(angle) * radius);
+                break;
+            }
+            default:
+                break;
+            }
+
+            glm::vec3 jitter = glm::vec3(rng.NextFloat(-1.0f, 1.0f), rng.NextFloat(-1.0f, 1.0f), rng.NextFloat(-1.0f, 1.0f)) * emitter.velocityJitter;
+            glm::vec3 position = emitter.position + offset;
+            glm::vec3 velocity = emitter.velocity + jitter;
+
+            int i = pool.alive++;
+            pool.positionX[i] = position.x; pool.positionY[i] = position.y; pool.positionZ[i] = position.z;
+            pool.velocityX[i] = velocity.x; pool.velocityY[i] = velocity.y; pool.velocityZ[i] = velocity.z;
+            pool.size[i] = rng.NextFloat(emitter.sizeMin, emitter.sizeMax);
+            pool.age[i] = 0.0f;
+            pool.lifetime[i] = rng.NextFloat(emitter.lifetimeMin, emitter.lifetimeMax);
+        }
+    }
+
+    void ParticleSystem::Kill(int i) {
+
+        int last = --pool.alive;
+        pool.positionX[i] = pool.positionX[last]; pool.positionY[i] = pool.positionY[last]; pool.positionZ[i] = pool.positionZ[last];
+        pool.velocityX[i] = pool.velocityX[last]; pool.velocityY[i] = pool.velocityY[last]; pool.velocityZ[i] = pool.velocityZ[last];
+        pool.size[i] = pool.size[last];
+        pool.age[i] = pool.age[last];
+        pool.lifetime[i] = pool.lifetime[last];
+    }
+
+    void ParticleSystem::Update(float deltaTime) {
+
+        for (int i = 0; i < pool.alive; ) {
+            pool.age[i] += deltaTime;
+            if (pool.age[i] >= pool.lifetime[i]) {
+                // the swapped-in particle is checked next, at the same index
+                Kill(i);
+            }
+            else {
+                i++;
+            }
+        }
+
+        emitAccumulator += emitter.rate * deltaTime;
+        int count = (int)emitAccumulator;
+        emitAccumulator -= count;
+        Emit(count);
+
+        kernel(pool, emitter, deltaTime);
+    }
+
+    // LSD radix sort of (key, index) pairs, 8 bits per pass; passes where every key has the
+    // same digit are skipped, which is common for the high bits of nearby depths. The result ends
+    // up in either array of each pair, the sorted indices are returned.
+    static const uint32_t* RadixSort(uint32_t* keys, uint32_t* indices, uint32_t* keysTemp, uint32_t* indicesTemp, int count) {
+
+        for (int shift = 0; shift < 32; shift += 8) {
+
+            int histogram[256] = { 0 };
+            for (int i = 0; i < count; i++) {
+                histogram[(keys[i] >> shift) & 0xFF]++;
+            }
+            if (histogram[(keys[0] >> shift) & 0xFF] == count) {
+                continue;
+            }
+
+            int offset = 0;
+            for (int digit = 0; digit < 256; digit++) {
+                int digitCount = histogram[digit];
+                histogram[digit] = offset;
+                offset += digitCount;
+            }
+
+            for (int i = 0; i < count; i++) {
+                int destination = histogram[(keys[i] >> shift) & 0xFF]++;
+                keysTemp[destination] = keys[i];
+                indicesTemp[destination] = indices[i];
+            }
+            std::swap(keys, keysTemp);
+            std::swap(indices, indicesTemp);
+        }
+        return indices;
+    }
+
+    const uint32_t* ParticleSystem::SortByDepth(const glm::mat4& view) {
+
+        int count = pool.alive;
+        glm::vec4 depthRow = glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]);
+
+        for (int i = 0; i < count; i++) {
+            // distance in front of the camera; positive floats order like their bits,
+            // inverted so the farthest particle comes first
+            float depth = -(depthRow.x * pool.positionX[i] + depthRow.y * pool.positionY[i] + depthRow.z * pool.positionZ[i] + depthRow.w);
+            depth = std::max(depth, 0.0f);
+            uint32_t bits;
+            std::memcpy(&bits, &depth, sizeof(bits));
+            sortKeys[i] = ~bits;
+            sortIndices[i] = i;
+        }
+
+        return RadixSort(sortKeys.data(), sortIndices.data(), sortKeysTemp.data(), sortIndicesTemp.data(), count);
+    }
+
+    int ParticleSystem::WriteInstances(const glm::mat4& view, ParticleInstance* output) {
+
+        int count = pool.alive;
+        if (count == 0) {
+            return 0;
+        }
+
+        const uint32_t* order = NULL;
+        if (!emitter.additive) {
+            order = SortByDepth(view);
+        }
+
+        for (int n = 0; n < count; n++) {
+            int i = order ? (int)order[n] : n;
+
+            float t = pool.age[i] / pool.lifetime[i];
+            glm::vec4 color = glm::mix(emitter.colorStart, emitter.colorEnd, t);
+
+            output[n].positionSize = glm::vec4(pool.positionX[i], pool.positionY[i], pool.positionZ[i], pool.size[i]);
+            output[n].color = glm::vec4(glm::vec3(color) * color.a, emitter.additive ? 0.0f : color.a);
+        }
+        return count;
+    }
+
+    int ParticleSystem::GetAliveCount() const {
+
+        return pool.alive;
+    }
+
+    int ParticleSystem::GetCapacity() const {
+
+        return pool.capacity;
+    }
+
+    int ParticleEngine::AddSystem(const EmitterDesc& emitter, int capacity, ParticleKernel kernel) {
+
+        int index = (int)systems.size();
+        systems.push_back(ParticleSystem());
+        systems.back().Create(emitter, capacity, kernel, 0x9A871C1Eull + index);
+
+        firstInstance.push_back(totalCapacity);
+        instanceCount.push_back(0);
+        totalCapacity += capacity;
+        return index;
+    }
+
+    ParticleSystem& ParticleEngine::GetSystem(int index) {
+
+        return systems[index];
+    }
+
+    int ParticleEngine::GetSystemCount() const {
+
+        return (int)systems.size();
+    }
+
+    int ParticleEngine::GetTotalCapacity() const {
+
+        return totalCapacity;
+    }
+
+    int ParticleEngine::GetFirstInstance(int index) const {
+
+        return firstInstance[index];
+    }
+
+    int ParticleEngine::GetInstanceCount(int index) const {
+
+        return instanceCount[index];
+    }
+
+    void ParticleEngine::Update(JobSystem* jobs, float deltaTime) {
+
+        std::function<void(int, int)> body = [this, deltaTime](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                systems[i].Update(deltaTime);
+            }
+        };
+
+        if (jobs == NULL) {
+            body(0, (int)systems.size());
+            return;
+        }
+        jobs->ParallelFor((int)systems.size(), 1, body);
+    }
+
+    void ParticleEngine::WriteInstances(JobSystem* jobs, const glm::mat4& view, ParticleInstance* output) {
+
+        std::function<void(int, int)> body = [this, &view, output](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                instanceCount[i] = systems[i].WriteInstances(view, output + firstInstance[i]);
+            }
+        };
+
+        if (jobs == NULL) {
+            body(0, (int)systems.size());
+            return;
+        }
+        jobs->ParallelFor((int)systems.size(), 1, body);
+    }
+}
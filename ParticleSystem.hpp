@@ -0,0 +1,144 @@
+#ifndef ParticleSystem_hpp
+#define ParticleSystem_hpp
+
+#include <glm/glm.hpp>
+
+#include "JobSystem.hpp"
+#include "Random.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    enum EmitterShape {
+        EMITTER_POINT,
+        // uniform inside a sphere of radius extents.x
+        EMITTER_SPHERE,
+        // uniform inside a box of half size extents
+        EMITTER_BOX,
+        // uniform on a horizontal disc of radius extents.x
+        EMITTER_DISC
+    };
+
+    // what a system spawns and how the default kernel moves it
+    struct EmitterDesc {
+        EmitterShape shape = EMITTER_POINT;
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 extents = glm::vec3(0.0f);
+
+        // particles per second, 0 stops the emitter and lets the live ones die out
+        float rate = 0.0f;
+        float lifetimeMin = 1.0f;
+        float lifetimeMax = 1.0f;
+
+        // initial velocity, plus a random offset in [-velocityJitter, velocityJitter]
+        glm::vec3 velocity = glm::vec3(0.0f);
+        glm::vec3 velocityJitter = glm::vec3(0.0f);
+
+        // gravity or buoyancy, and the fraction of velocity lost per second
+        glm::vec3 acceleration = glm::vec3(0.0f);
+        float drag = 0.0f;
+
+        // world size in meters, growing by sizeGrowth per second
+        float sizeMin = 0.1f;
+        float sizeMax = 0.1f;
+        float sizeGrowth = 0.0f;
+
+        // interpolated over the lifetime
+        glm::vec4 colorStart = glm::vec4(1.0f);
+        glm::vec4 colorEnd = glm::vec4(1.0f);
+
+        // additive particles (sparks, embers) need no sorting; alpha blended ones (smoke) are
+        // drawn back to front
+        bool additive = false;
+    };
+
+    // Fixed capacity particle storage as a structure of arrays; [0, alive) are live particles,
+    // dead ones are swapped with the last live one, so nothing is allocated after Create().
+    struct ParticlePool {
+        int capacity;
+        int alive;
+
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> velocityX, velocityY, velocityZ;
+        std::vector<float> size;
+        std::vector<float> age;
+        std::vector<float> lifetime;
+    };
+
+    // advances the live particles of a pool; ageing and killing is done by the system
+    typedef void (*ParticleKernel)(ParticlePool& pool, const EmitterDesc& emitter, float deltaTime);
+
+    // acceleration, drag and size growth - enough for most systems, custom kernels can call it
+    // and add their own forces
+    void IntegrateParticles(ParticlePool& pool, const EmitterDesc& emitter, float deltaTime);
+
+    // per instance vertex data of particle.vert: position + size and premultiplied color
+    // (alpha 0 for additive particles, so one blend function serves both kinds)
+    struct ParticleInstance {
+        glm::vec4 positionSize;
+        glm::vec4 color;
+    };
+
+    class ParticleSystem {
+
+    public:
+        void Create(const EmitterDesc& emitter, int capacity, ParticleKernel kernel, uint64_t seed);
+
+        // the emitter can be changed between updates (moved, switched off, ...)
+        EmitterDesc& GetEmitter();
+
+        // emits, runs the kernel and removes the particles past their lifetime
+        void Update(float deltaTime);
+        // writes the live particles to output (capacity entries at most), back to front for
+        // alpha blended systems; returns the number written
+        int WriteInstances(const glm::mat4& view, ParticleInstance* output);
+
+        int GetAliveCount() const;
+        int GetCapacity() const;
+
+    private:
+        EmitterDesc emitter;
+        ParticleKernel kernel;
+        ParticlePool pool;
+        Xoshiro128 rng;
+        float emitAccumulator;
+
+        // radix sort scratch, kept between frames
+        std::vector<uint32_t> sortKeys, sortIndices, sortKeysTemp, sortIndicesTemp;
+
+        void Emit(int count);
+        void Kill(int i);
+        // back to front order of the live particles
+        const uint32_t* SortByDepth(const glm::mat4& view);
+    };
+
+    // Owns the particle systems of the scene; each system is updated, then written, as one job.
+    class ParticleEngine {
+
+    public:
+        // returns the index of the new system
+        int AddSystem(const EmitterDesc& emitter, int capacity, ParticleKernel kernel = IntegrateParticles);
+        ParticleSystem& GetSystem(int index);
+        int GetSystemCount() const;
+
+        // sum of the capacities, the size of the instance buffer passed to WriteInstances()
+        int GetTotalCapacity() const;
+        // system i writes its instances at output + GetFirstInstance(i)
+        int GetFirstInstance(int index) const;
+        int GetInstanceCount(int index) const;
+
+        void Update(JobSystem* jobs, float deltaTime);
+        // separate from Update() so the sort can use the view the frame is rendered with
+        void WriteInstances(JobSystem* jobs, const glm::mat4& view, ParticleInstance* output);
+
+    private:
+        std::vector<ParticleSystem> systems;
+        std::vector<int> firstInstance;
+        std::vector<int> instanceCount;
+        int totalCapacity = 0;
+    };
+}
+
+#endif /* ParticleSystem_hpp */
@@ -0,0 +1,50 @@
+#include "Random.hpp"
+
+namespace gps {
+
+    static uint32_t RotateLeft(uint32_t x, int k) {
+
+        return (x << k) | (x >> (32 - k));
+    }
+
+    void Xoshiro128::Seed(uint64_t seed) {
+
+        // splitmix64 spreads any seed over the whole state, which must not be all zero
+        for (int i = 0; i < 4; i += 2) {
+
+            seed += 0x9E3779B97F4A7C15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z = z ^ (z >> 31);
+            state[i] = (uint32_t)z;
+            state[i + 1] = (uint32_t)(z >> 32);
+        }
+    }
+
+    uint32_t Xoshiro128::Next() {
+
+        uint32_t result = RotateLeft(state[1] * 5, 7) * 9;
+        uint32_t t = state[1] << 9;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = RotateLeft(state[3], 11);
+
+        return result;
+    }
+
+    float Xoshiro128::NextFloat() {
+
+        // the top 24 bits fill a float mantissa exactly
+        return (Next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    float Xoshiro128::NextFloat(float min, float max) {
+
+        return min + NextFloat() * (max - min);
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef Random_hpp
+#define Random_hpp
+
+#include <cstdint>
+
+namespace gps {
+
+    // xoshiro128** - small, fast and much better distributed than rand(), one state per thread
+    struct Xoshiro128 {
+        uint32_t state[4];
+
+        void Seed(uint64_t seed);
+        uint32_t Next();
+        // uniform in [0, 1)
+        float NextFloat();
+        // uniform in [min, max)
+        float NextFloat(float min, float max);
+    };
+}
+
+#endif /* Random_hpp */
@@ -0,0 +1,527 @@
+#include "RenderGraph.hpp"
+
+#include <iostream>
+
+namespace gps {
+
+    // pooled textures nobody asked for during this many frames are released
+    const int POOL_RELEASE_FRAMES = 120;
+
+    bool IsDepthFormat(GLenum internalFormat) {
+
+        return internalFormat == GL_DEPTH_COMPONENT16 || internalFormat == GL_DEPTH_COMPONENT24 ||
+            internalFormat == GL_DEPTH_COMPONENT32F || internalFormat == GL_DEPTH24_STENCIL8;
+    }
+
+    void RenderPassBuilder::Read(RenderResource resource) {
+
+        graph->passes[pass].reads.push_back(resource);
+    }
+
+    void RenderPassBuilder::Write(RenderResource resource) {
+
+        graph->passes[pass].writes.push_back(resource);
+        graph->resources[resource].writers.push_back(pass);
+    }
+
+    void RenderPassBuilder::SetState(const RenderPassState& state) {
+
+        graph->passes[pass].state = state;
+    }
+
+    void RenderPassBuilder::SetManualTargets() {
+
+        graph->passes[pass].manualTargets = true;
+    }
+
+    GLuint RenderPassContext::GetTexture(RenderResource resource) const {
+
+        return graph->resources[resource].texture;
+    }
+
+    int RenderPassContext::BindTexture(gps::Shader& shader, const char* samplerName, RenderResource resource) {
+
+        const RenderGraph::Resource& r = graph->resources[resource];
+        int unit = nextTextureUnit++;
+
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(r.target, r.texture);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, samplerName), unit);
+        glActiveTexture(GL_TEXTURE0);
+        return unit;
+    }
+
+    int RenderPassContext::AllocateTextureUnits(int count) {
+
+        int first = nextTextureUnit;
+        nextTextureUnit += count;
+        return first;
+    }
+
+    int RenderPassContext::GetWidth() const {
+
+        return width;
+    }
+
+    int RenderPassContext::GetHeight() const {
+
+        return height;
+    }
+
+    void RenderGraph::Reset() {
+
+        resources.clear();
+        passes.clear();
+        order.clear();
+    }
+
+    void RenderGraph::Delete() {
+
+        for (std::map<std::vector<GLuint>, GLuint>::iterator it = framebufferCache.begin(); it != framebufferCache.end(); ++it) {
+            glDeleteFramebuffers(1, &it->second);
+        }
+        framebufferCache.clear();
+
+        for (size_t i = 0; i < pool.size(); i++) {
+            glDeleteTextures(1, &pool[i].texture);
+        }
+        pool.clear();
+        Reset();
+    }
+
+    RenderResource RenderGraph::ImportTexture(const std::string& name, GLuint texture, GLenum target, int width, int height) {
+
+        Resource r;
+        r.name = name;
+        r.imported = true;
+        r.isFramebuffer = false;
+        r.texture = texture;
+        r.framebuffer = 0;
+        r.target = target;
+        r.desc.width = width;
+        r.desc.height = height;
+        r.desc.internalFormat = GL_NONE;
+        r.output = false;
+        r.refCount = 0;
+        r.firstUse = r.lastUse = -1;
+        r.physical = -1;
+        resources.push_back(r);
+        return (RenderResource)resources.size() - 1;
+    }
+
+    RenderResource RenderGraph::ImportFramebuffer(const std::string& name, GLuint framebuffer, int width, int height) {
+
+        RenderResource resource = ImportTexture(name, 0, GL_NONE, width, height);
+        resources[resource].isFramebuffer = true;
+        resources[resource].framebuffer = framebuffer;
+        return resource;
+    }
+
+    RenderResource RenderGraph::CreateTexture(const std::string& name, const RenderTargetDesc& desc) {
+
+        RenderResource resource = ImportTexture(name, 0, GL_TEXTURE_2D, desc.width, desc.height);
+        resources[resource].imported = false;
+        resources[resource].desc = desc;
+        return resource;
+    }
+
+    void RenderGraph::MarkOutput(RenderResource resource) {
+
+        resources[resource].output = true;
+    }
+
+    void RenderGraph::AddPass(const std::string& name, std::function<void(RenderPassBuilder&)> setup, std::function<void(RenderPassContext&)> execute) {
+
+        Pass p;
+        p.name = name;
+        p.manualTargets = false;
+        p.execute = execute;
+        p.refCount = 0;
+        p.culled = false;
+        passes.push_back(p);
+
+        RenderPassBuilder builder;
+        builder.graph = this;
+        builder.pass = (int)passes.size() - 1;
+        setup(builder);
+    }
+
+    void RenderGraph::Compile() {
+
+        // 1. culling: a pass lives while one of its outputs is read by a living pass or is a graph output
+        for (size_t p = 0; p < passes.size(); p++) {
+
+            passes[p].refCount = (int)passes[p].writes.size();
+            passes[p].culled = false;
+            for (size_t i = 0; i < passes[p].reads.size(); i++) {
+                resources[passes[p].reads[i]].refCount++;
+            }
+        }
+
+        std::vector<RenderResource> unused;
+        for (size_t r = 0; r < resources.size(); r++) {
+
+            if (resources[r].output)
+                resources[r].refCount++;
+            if (resources[r].refCount == 0)
+                unused.push_back((RenderResource)r);
+        }
+
+        while (!unused.empty()) {
+
+            RenderResource r = unused.back();
+            unused.pop_back();
+
+            for (size_t w = 0; w < resources[r].writers.size(); w++) {
+
+                Pass& writer = passes[resources[r].writers[w]];
+                if (writer.culled || --writer.refCount > 0)
+                    continue;
+
+                writer.culled = true;
+                for (size_t i = 0; i < writer.reads.size(); i++) {
+                    if (--resources[writer.reads[i]].refCount == 0)
+                        unused.push_back(writer.reads[i]);
+                }
+            }
+        }
+
+        // 2. ordering: every pass depends on the earlier passes that wrote what it touches
+        //    (read after write and write after write) and on earlier readers of what it writes
+        //    (write after read); Kahn's algorithm, ties broken by declaration order
+        std::vector<std::vector<int> > dependents(passes.size());
+        std::vector<int> pending(passes.size(), 0);
+        for (size_t p = 0; p < passes.size(); p++) {
+
+            if (passes[p].culled)
+                continue;
+
+            for (size_t q = 0; q < p; q++) {
+
+                if (passes[q].culled)
+                    continue;
+
+                bool depends = false;
+                for (size_t a = 0; a < passes[q].writes.size() && !depends; a++) {
+
+                    RenderResource r = passes[q].writes[a];
+                    for (size_t b = 0; b < passes[p].reads.size(); b++)
+                        depends = depends || passes[p].reads[b] == r;
+                    for (size_t b = 0; b < passes[p].writes.size(); b++)
+                        depends = depends || passes[p].writes[b] == r;
+                }
+                for (size_t a = 0; a < passes[q].reads.size() && !depends; a++) {
+
+                    for (size_t b = 0; b < passes[p].writes.size(); b++)
+                        depends = depends || passes[p].writes[b] == passes[q].reads[a];
+                }
+
+                if (depends) {
+                    dependents[q].push_back((int)p);
+                    pending[p]++;
+                }
+            }
+        }
+
+        order.clear();
+        std::vector<bool> scheduled(passes.size(), false);
+        for (;;) {
+
+            int next = -1;
+            for (size_t p = 0; p < passes.size() && next < 0; p++) {
+                if (!passes[p].culled && !scheduled[p] && pending[p] == 0)
+                    next = (int)p;
+            }
+            if (next < 0)
+                break;
+
+            scheduled[next] = true;
+            order.push_back(next);
+            for (size_t d = 0; d < dependents[next].size(); d++) {
+                pending[dependents[next][d]]--;
+            }
+        }
+
+        // 3. lifetimes of the transient textures over the execution order
+        for (size_t i = 0; i < order.size(); i++) {
+
+            const Pass& p = passes[order[i]];
+            for (int k = 0; k < 2; k++) {
+
+                const std::vector<RenderResource>& list = (k == 0) ? p.reads : p.writes;
+                for (size_t j = 0; j < list.size(); j++) {
+
+                    Resource& r = resources[list[j]];
+                    if (r.firstUse < 0)
+                        r.firstUse = (int)i;
+                    r.lastUse = (int)i;
+                    if (!r.imported && k == 0 && r.writers.empty())
+                        std::cout << "Render graph: pass " << p.name << " reads " << r.name << " which nobody writes" << std::endl;
+                }
+            }
+        }
+
+        // 4. allocation: transients whose lifetimes do not overlap share one pooled texture
+        for (size_t i = 0; i < pool.size(); i++) {
+            pool[i].busyUntil = -1;
+        }
+        for (size_t i = 0; i < order.size(); i++) {
+
+            for (size_t r = 0; r < resources.size(); r++) {
+
+                Resource& res = resources[r];
+                if (res.imported || res.firstUse != (int)i)
+                    continue;
+
+                res.physical = FindPooledTexture(res.desc, res.firstUse);
+                pool[res.physical].busyUntil = res.lastUse;
+                pool[res.physical].unusedFrames = 0;
+                res.texture = pool[res.physical].texture;
+            }
+        }
+
+        ReleaseUnusedTextures();
+    }
+
+    int RenderGraph::FindPooledTexture(const RenderTargetDesc& desc, int firstUse) {
+
+        for (size_t i = 0; i < pool.size(); i++) {
+
+            const PooledTexture& t = pool[i];
+            if (t.busyUntil < firstUse && t.desc.width == desc.width && t.desc.height == desc.height && t.desc.internalFormat == desc.internalFormat)
+                return (int)i;
+        }
+
+        // the upload format has to match the internal format even without data
+        GLenum format = GL_RGBA, type = GL_FLOAT;
+        if (desc.internalFormat == GL_DEPTH24_STENCIL8) {
+            format = GL_DEPTH_STENCIL;
+            type = GL_UNSIGNED_INT_24_8;
+        }
+        else if (IsDepthFormat(desc.internalFormat)) {
+            format = GL_DEPTH_COMPONENT;
+        }
+
+        PooledTexture t;
+        t.desc = desc;
+        t.busyUntil = -1;
+        t.unusedFrames = 0;
+        glGenTextures(1, &t.texture);
+        glBindTexture(GL_TEXTURE_2D, t.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        pool.push_back(t);
+        return (int)pool.size() - 1;
+    }
+
+    void RenderGraph::ReleaseUnusedTextures() {
+
+        bool released = false;
+        for (size_t i = 0; i < pool.size(); ) {
+
+            if (pool[i].busyUntil < 0 && ++pool[i].unusedFrames > POOL_RELEASE_FRAMES) {
+                glDeleteTextures(1, &pool[i].texture);
+                pool.erase(pool.begin() + i);
+                released = true;
+            }
+            else {
+                i++;
+            }
+        }
+
+        if (!released)
+            return;
+
+        // physical indices of this frame moved, refresh them
+        for (size_t r = 0; r < resources.size(); r++) {
+
+            if (resources[r].imported)
+                continue;
+            for (size_t i = 0; i < pool.size(); i++) {
+                if (pool[i].texture == resources[r].texture)
+                    resources[r].physical = (int)i;
+            }
+        }
+
+        // cached FBOs may point at a deleted texture
+        for (std::map<std::vector<GLuint>, GLuint>::iterator it = framebufferCache.begin(); it != framebufferCache.end(); ++it) {
+            glDeleteFramebuffers(1, &it->second);
+        }
+        framebufferCache.clear();
+    }
+
+    GLuint RenderGraph::GetFramebuffer(const Pass& pass, int& width, int& height, int& colorCount) {
+
+        std::vector<GLuint> colors;
+        GLuint depth = 0;
+        GLenum depthAttachment = GL_DEPTH_ATTACHMENT;
+
+        for (size_t i = 0; i < pass.writes.size(); i++) {
+
+            const Resource& r = resources[pass.writes[i]];
+            width = r.desc.width;
+            height = r.desc.height;
+
+            // imported framebuffers are bound as they are
+            if (r.isFramebuffer) {
+                colorCount = -1;
+                return r.framebuffer;
+            }
+
+            if (IsDepthFormat(r.desc.internalFormat)) {
+                depth = r.texture;
+                depthAttachment = r.desc.internalFormat == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+            }
+            else
+                colors.push_back(r.texture);
+        }
+        colorCount = (int)colors.size();
+
+        // key: color attachments followed by the depth attachment
+        std::vector<GLuint> key = colors;
+        key.push_back(depth);
+
+        std::map<std::vector<GLuint>, GLuint>::iterator it = framebufferCache.find(key);
+        if (it != framebufferCache.end())
+            return it->second;
+
+        GLuint fbo;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        for (size_t i = 0; i < colors.size(); i++) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + (GLenum)i, GL_TEXTURE_2D, colors[i], 0);
+        }
+        if (depth != 0)
+            glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depth, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Render graph: framebuffer of pass " << pass.name << " is not complete" << std::endl;
+
+        framebufferCache[key] = fbo;
+        return fbo;
+    }
+
+    void RenderGraph::ApplyState(const RenderPassState& state) {
+
+        if (state.depthTest)
+            glEnable(GL_DEPTH_TEST);
+        else
+            glDisable(GL_DEPTH_TEST);
+        glDepthFunc(state.depthFunc);
+        glDepthMask(state.depthWrite ? GL_TRUE : GL_FALSE);
+
+        if (state.cullFace)
+            glEnable(GL_CULL_FACE);
+        else
+            glDisable(GL_CULL_FACE);
+        glCullFace(state.cullMode);
+
+        if (state.blend)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+        glBlendFunc(state.blendSrc, state.blendDst);
+
+        GLboolean colorMask = state.colorWrite ? GL_TRUE : GL_FALSE;
+        glColorMask(colorMask, colorMask, colorMask, colorMask);
+    }
+
+    void RenderGraph::SetProfiler(GpuProfiler* profiler) {
+
+        this->profiler = profiler;
+    }
+
+    void RenderGraph::Execute() {
+
+        static const GLenum drawBuffers[] = {
+            GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3,
+            GL_COLOR_ATTACHMENT4, GL_COLOR_ATTACHMENT5, GL_COLOR_ATTACHMENT6, GL_COLOR_ATTACHMENT7
+        };
+
+        for (size_t i = 0; i < order.size(); i++) {
+
+            Pass& pass = passes[order[i]];
+
+            RenderPassContext context;
+            context.graph = this;
+            context.nextTextureUnit = FIRST_TEXTURE_UNIT;
+            context.width = 0;
+            context.height = 0;
+
+            if (!pass.manualTargets && !pass.writes.empty()) {
+
+                int colorCount = 0;
+                GLuint fbo = GetFramebuffer(pass, context.width, context.height, colorCount);
+                glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+                if (colorCount == 0)
+                    glDrawBuffer(GL_NONE);
+                else if (colorCount > 0)
+                    glDrawBuffers(colorCount, drawBuffers);
+                glViewport(0, 0, context.width, context.height);
+            }
+
+            // glClear honours the write masks, so clear before the pass state can turn them off
+            GLbitfield clearMask = 0;
+            if (pass.state.clearColor)
+                clearMask |= GL_COLOR_BUFFER_BIT;
+            if (pass.state.clearDepth)
+                clearMask |= GL_DEPTH_BUFFER_BIT;
+            if (clearMask != 0) {
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                glDepthMask(GL_TRUE);
+                glClear(clearMask);
+            }
+
+            ApplyState(pass.state);
+
+            if (profiler != NULL) {
+                profiler->Begin(pass.name);
+            }
+            pass.execute(context);
+            if (profiler != NULL) {
+                profiler->End();
+            }
+        }
+
+        // leave the context the way the rest of the code expects it
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        ApplyState(RenderPassState());
+    }
+
+    std::string RenderGraph::Describe() const {
+
+        std::string text;
+        for (size_t i = 0; i < order.size(); i++) {
+            text += (i == 0 ? "" : " > ") + passes[order[i]].name;
+        }
+
+        std::string culled;
+        for (size_t p = 0; p < passes.size(); p++) {
+            if (passes[p].culled)
+                culled += (culled.empty() ? "" : ", ") + passes[p].name;
+        }
+        if (!culled.empty())
+            text += " (culled: " + culled + ")";
+
+        int transients = 0;
+        std::vector<int> physical;
+        for (size_t r = 0; r < resources.size(); r++) {
+
+            if (resources[r].imported || resources[r].physical < 0)
+                continue;
+            transients++;
+            bool seen = false;
+            for (size_t i = 0; i < physical.size(); i++)
+                seen = seen || physical[i] == resources[r].physical;
+            if (!seen)
+                physical.push_back(resources[r].physical);
+        }
+        text += ", " + std::to_string(transients) + " transient targets in " + std::to_string(physical.size()) + " textures";
+        return text;
+    }
+}
@@ -0,0 +1,172 @@
+#ifndef RenderGraph_hpp
+#define RenderGraph_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "Shader.hpp"
+#include "GpuProfiler.hpp"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // index of a resource inside the graph of the current frame
+    typedef int RenderResource;
+
+    struct RenderTargetDesc {
+        int width;
+        int height;
+        GLenum internalFormat;
+    };
+
+    // fixed function state the graph sets before running a pass
+    struct RenderPassState {
+        bool depthTest = true;
+        GLenum depthFunc = GL_LESS;
+        bool depthWrite = true;
+        bool cullFace = true;
+        GLenum cullMode = GL_BACK;
+        bool blend = false;
+        GLenum blendSrc = GL_SRC_ALPHA;
+        GLenum blendDst = GL_ONE_MINUS_SRC_ALPHA;
+        bool colorWrite = true;
+        bool clearColor = false;
+        bool clearDepth = false;
+    };
+
+    class RenderGraph;
+
+    // handed to the setup callback of a pass to declare what it reads and writes
+    class RenderPassBuilder {
+
+    public:
+        void Read(RenderResource resource);
+        // color formats become color attachments in declaration order, depth formats the depth attachment
+        void Write(RenderResource resource);
+        void SetState(const RenderPassState& state);
+        // the pass binds its own framebuffers (e.g. one per shadow cascade)
+        void SetManualTargets();
+
+    private:
+        friend class RenderGraph;
+        RenderGraph* graph;
+        int pass;
+    };
+
+    // handed to the execute callback of a pass
+    class RenderPassContext {
+
+    public:
+        GLuint GetTexture(RenderResource resource) const;
+        // binds the texture to the next free unit and points the sampler uniform at it
+        int BindTexture(gps::Shader& shader, const char* samplerName, RenderResource resource);
+        // reserves count consecutive texture units for textures the caller binds itself
+        int AllocateTextureUnits(int count);
+        int GetWidth() const;
+        int GetHeight() const;
+
+    private:
+        friend class RenderGraph;
+        RenderGraph* graph;
+        int nextTextureUnit;
+        int width, height;
+    };
+
+    // Small per-frame render graph: passes declare their inputs and outputs, the graph orders them,
+    // culls passes whose outputs nobody consumes, allocates (and aliases) transient render targets
+    // and owns FBO binding, viewport, depth/cull/blend state and texture unit assignment.
+    class RenderGraph {
+
+    public:
+        // units below this one are left to the material textures of gps::Mesh
+        static const int FIRST_TEXTURE_UNIT = 3;
+
+        // starts a new frame, the pooled textures and FBOs are kept
+        void Reset();
+        void Delete();
+
+        // persistent texture owned by someone else (shadow cascades, ...)
+        RenderResource ImportTexture(const std::string& name, GLuint texture, GLenum target, int width, int height);
+        // existing framebuffer, e.g. the default one
+        RenderResource ImportFramebuffer(const std::string& name, GLuint framebuffer, int width, int height);
+        // texture that only lives during this frame, its memory may be shared with other transients
+        RenderResource CreateTexture(const std::string& name, const RenderTargetDesc& desc);
+        // resources that must be produced even though no pass reads them
+        void MarkOutput(RenderResource resource);
+
+        void AddPass(const std::string& name, std::function<void(RenderPassBuilder&)> setup, std::function<void(RenderPassContext&)> execute);
+
+        void Compile();
+        void Execute();
+
+        // times every executed pass under its name; NULL turns it off
+        void SetProfiler(GpuProfiler* profiler);
+
+        // one line summary of the compiled frame, e.g. for logging when the frame layout changes
+        std::string Describe() const;
+
+    private:
+        friend class RenderPassBuilder;
+        friend class RenderPassContext;
+
+        struct Resource {
+            std::string name;
+            bool imported;
+            bool isFramebuffer;
+            GLuint texture;
+            GLuint framebuffer;
+            GLenum target;
+            RenderTargetDesc desc;
+            bool output;
+            int refCount;
+            std::vector<int> writers;
+            int firstUse, lastUse;
+            int physical;
+        };
+
+        struct Pass {
+            std::string name;
+            std::vector<RenderResource> reads;
+            std::vector<RenderResource> writes;
+            RenderPassState state;
+            bool manualTargets;
+            std::function<void(RenderPassContext&)> execute;
+            int refCount;
+            bool culled;
+        };
+
+        struct PooledTexture {
+            RenderTargetDesc desc;
+            GLuint texture;
+            int busyUntil;
+            int unusedFrames;
+        };
+
+        std::vector<Resource> resources;
+        std::vector<Pass> passes;
+        std::vector<int> order;
+
+        std::vector<PooledTexture> pool;
+        std::map<std::vector<GLuint>, GLuint> framebufferCache;
+
+        GpuProfiler* profiler = NULL;
+
+        int FindPooledTexture(const RenderTargetDesc& desc, int firstUse);
+        GLuint GetFramebuffer(const Pass& pass, int& width, int& height, int& colorCount);
+        void ApplyState(const RenderPassState& state);
+        void ReleaseUnusedTextures();
+    };
+
+    bool IsDepthFormat(GLenum internalFormat);
+}
+
+#endif /* RenderGraph_hpp */
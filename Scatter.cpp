@@ -0,0 +1,118 @@
+#include "Scatter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gps {
+
+    // candidates tried around an active point before it is retired
+    static const int POISSON_ATTEMPTS = 30;
+
+    std::vector<glm::vec2> ScatterGrid(int count, glm::vec2 min, glm::vec2 max) {
+
+        std::vector<glm::vec2> points;
+        if (count <= 0) {
+            return points;
+        }
+
+        glm::vec2 size = max - min;
+        int columns = std::max((int)std::ceil(std::sqrt(count * size.x / std::max(size.y, 1e-6f))), 1);
+        columns = std::min(columns, count);
+        int rows = (count + columns - 1) / columns;
+        glm::vec2 cell = size / glm::vec2((float)columns, (float)rows);
+
+        for (int i = 0; i < count; i++) {
+            glm::vec2 index((float)(i % columns), (float)(i / columns));
+            points.push_back(min + (index + glm::vec2(0.5f)) * cell);
+        }
+        return points;
+    }
+
+    std::vector<glm::vec2> ScatterPoissonDisk(float radius, glm::vec2 min, glm::vec2 max, Xoshiro128& rng) {
+
+        std::vector<glm::vec2> points;
+        glm::vec2 size = max - min;
+        if (radius <= 0.0f || size.x <= 0.0f || size.y <= 0.0f) {
+            return points;
+        }
+
+        // a cell is small enough to hold at most one point
+        float cellSize = radius / std::sqrt(2.0f);
+        int width = (int)std::ceil(size.x / cellSize);
+        int height = (int)std::ceil(size.y / cellSize);
+        std::vector<int> grid((size_t)width * height, -1);
+
+        std::vector<int> active;
+        glm::vec2 first(rng.NextFloat(min.x, max.x), rng.NextFloat(min.y, max.y));
+        points.push_back(first);
+        active.push_back(0);
+        grid[std::min((int)((first.y - min.y) / cellSize), height - 1) * width + std::min((int)((first.x - min.x) / cellSize), width - 1)] = 0;
+
+        while (!active.empty()) {
+            int slot = (int)(rng.Next() % active.size());
+            glm::vec2 center = points[active[slot]];
+
+            bool placed = false;
+            for (int attempt = 0; attempt < POISSON_ATTEMPTS && !placed; attempt++) {
+                // uniform over the annulus [radius, 2 radius]
+                float angle = rng.NextFloat(0.0f, 6.2831853f);
+                float distance = radius * std::sqrt(rng.NextFloat(1.0f, 4.0f));
+                glm::vec2 candidate = center + distance * glm::vec2(std::cos(angle), std::sin(angle));
+                if (candidate.x < min.x || candidate.y < min.y || candidate.x >= max.x || candidate.y >= max.y) {
+                    continue;
+                }
+
+                int cellX = std::min((int)((candidate.x - min.x) / cellSize), width - 1);
+                int cellY = std::min((int)((candidate.y - min.y) / cellSize), height - 1);
+                bool free = true;
+                for (int y = std::max(cellY - 2, 0); y <= std::min(cellY + 2, height - 1) && free; y++) {
+                    for (int x = std::max(cellX - 2, 0); x <= std::min(cellX + 2, width - 1) && free; x++) {
+                        int other = grid[y * width + x];
+                        if (other >= 0) {
+                            glm::vec2 offset = points[other] - candidate;
+                            free = glm::dot(offset, offset) >= radius * radius;
+                        }
+                    }
+                }
+                if (!free) {
+                    continue;
+                }
+
+                grid[cellY * width + cellX] = (int)points.size();
+                active.push_back((int)points.size());
+                points.push_back(candidate);
+                placed = true;
+            }
+
+            if (!placed) {
+                active[slot] = active.back();
+                active.pop_back();
+            }
+        }
+        return points;
+    }
+
+    std::vector<glm::vec2> ScatterPoints(ScatterLayout layout, int count, glm::vec2 min, glm::vec2 max, Xoshiro128& rng) {
+
+        glm::vec2 size = max - min;
+        if (layout == SCATTER_GRID || count <= 0 || size.x <= 0.0f || size.y <= 0.0f) {
+            return ScatterGrid(count, min, max);
+        }
+
+        // a full Poisson-disk set holds about 0.7 / radius^2 points per unit area; the radius
+        // shrinks until there are enough, then a random subset keeps the spacing
+        float radius = std::sqrt(size.x * size.y / count);
+        std::vector<glm::vec2> points = ScatterPoissonDisk(radius, min, max, rng);
+        while ((int)points.size() < count) {
+            radius *= 0.8f;
+            points = ScatterPoissonDisk(radius, min, max, rng);
+        }
+
+        for (int i = 0; i < count; i++) {
+            int other = i + (int)(rng.Next() % (uint32_t)(points.size() - i));
+            std::swap(points[i], points[other]);
+        }
+        points.resize(count);
+        return points;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef Scatter_hpp
+#define Scatter_hpp
+
+#include <glm/glm.hpp>
+
+#include "Random.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    enum ScatterLayout {
+        // cell centers of a regular grid, row by row
+        SCATTER_GRID,
+        // blue noise: random, but no two points closer than a minimum distance
+        SCATTER_POISSON
+    };
+
+    // count points over the rectangle [min, max], the same ones for the same rng state
+    std::vector<glm::vec2> ScatterPoints(ScatterLayout layout, int count, glm::vec2 min, glm::vec2 max, Xoshiro128& rng);
+
+    // as square as the rectangle allows, the last row may be partly filled
+    std::vector<glm::vec2> ScatterGrid(int count, glm::vec2 min, glm::vec2 max);
+
+    // Bridson's Poisson-disk sampling: every point at least radius away from the others, until
+    // no more fit
+    std::vector<glm::vec2> ScatterPoissonDisk(float radius, glm::vec2 min, glm::vec2 max, Xoshiro128& rng);
+}
+
+#endif /* Scatter_hpp */
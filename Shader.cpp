@@ -30,6 +30,20 @@ namespace gps {
         return shaderString;
     }
     
+    std::string Shader::injectDefines(std::string source, std::string defines) {
+
+        if (defines.empty())
+            return source;
+
+        //the #version directive has to stay the first line
+        size_t versionLine = source.find("#version");
+        size_t lineEnd = (versionLine == std::string::npos) ? std::string::npos : source.find('\n', versionLine);
+        if (lineEnd == std::string::npos)
+            return defines + source;
+
+        return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+    }
+    
     void Shader::shaderCompileLog(GLuint shaderId) {
 
         GLint success;
@@ -60,8 +74,13 @@ namespace gps {
     
     void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
 
+        loadShader(vertexShaderFileName, fragmentShaderFileName, "");
+    }
+    
+    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, std::string defines) {
+
         //read, parse and compile the vertex shader
-        std::string v = readShaderFile(vertexShaderFileName);
+        std::string v = injectDefines(readShaderFile(vertexShaderFileName), defines);
         const GLchar* vertexShaderString = v.c_str();
         GLuint vertexShader;
         vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -71,7 +90,7 @@ namespace gps {
         shaderCompileLog(vertexShader);
         
         //read, parse and compile the vertex shader
-        std::string f = readShaderFile(fragmentShaderFileName);
+        std::string f = injectDefines(readShaderFile(fragmentShaderFileName), defines);
         const GLchar* fragmentShaderString = f.c_str();
         GLuint fragmentShader;
         fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -91,6 +110,28 @@ namespace gps {
         shaderLinkLog(this->shaderProgram);
     }
     
+    void Shader::loadTransformFeedbackShader(std::string vertexShaderFileName, const std::vector<const GLchar*>& varyings) {
+
+        //read, parse and compile the vertex shader
+        std::string v = readShaderFile(vertexShaderFileName);
+        const GLchar* vertexShaderString = v.c_str();
+        GLuint vertexShader;
+        vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &vertexShaderString, NULL);
+        glCompileShader(vertexShader);
+        //check compilation status
+        shaderCompileLog(vertexShader);
+
+        //the captured outputs have to be declared before linking
+        this->shaderProgram = glCreateProgram();
+        glAttachShader(this->shaderProgram, vertexShader);
+        glTransformFeedbackVaryings(this->shaderProgram, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+        glLinkProgram(this->shaderProgram);
+        glDeleteShader(vertexShader);
+        //check linking info
+        shaderLinkLog(this->shaderProgram);
+    }
+    
     void Shader::useShaderProgram() {
 
         glUseProgram(this->shaderProgram);
@@ -20,6 +20,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 
 
 namespace gps {
@@ -29,10 +30,15 @@ namespace gps {
     public:
         GLuint shaderProgram;
         void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName);
+        // defines (e.g. "#define PCF_TAPS 4\n") are inserted right after the #version line of both stages
+        void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, std::string defines);
+        // vertex-only program whose outputs are captured interleaved by transform feedback
+        void loadTransformFeedbackShader(std::string vertexShaderFileName, const std::vector<const GLchar*>& varyings);
         void useShaderProgram();
     
     private:
         std::string readShaderFile(std::string fileName);
+        std::string injectDefines(std::string source, std::string defines);
         void shaderCompileLog(GLuint shaderId);
         void shaderLinkLog(GLuint shaderProgramId);
     };
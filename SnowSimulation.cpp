@@ -0,0 +1,126 @@
+#include "SnowSimulation.hpp"
+#include "Heightfield.hpp"
+
+#include <atomic>
+#include <cmath>
+
+namespace gps {
+
+    // every thread gets its own generator, seeded once from a shared counter
+    static Xoshiro128& ThreadRandom() {
+
+        static std::atomic<uint64_t> nextSeed(0x5EED);
+        static thread_local bool seeded = false;
+        static thread_local Xoshiro128 rng;
+
+        if (!seeded) {
+            rng.Seed(nextSeed++);
+            seeded = true;
+        }
+        return rng;
+    }
+
+    void SnowSimulation::Create(int particleCount, glm::vec3 volumeMin, glm::vec3 volumeSize) {
+
+        this->particleCount = particleCount;
+        this->volumeMin = volumeMin;
+        this->volumeSize = volumeSize;
+        surface = NULL;
+
+        positionX.resize(particleCount); positionY.resize(particleCount); positionZ.resize(particleCount);
+        velocityX.resize(particleCount); velocityY.resize(particleCount); velocityZ.resize(particleCount);
+        size.resize(particleCount);
+        lifetime.resize(particleCount);
+
+        Xoshiro128& rng = ThreadRandom();
+        for (int i = 0; i < particleCount; i++) {
+            Respawn(i, rng, true);
+        }
+    }
+
+    void SnowSimulation::Respawn(int i, Xoshiro128& rng, bool initial) {
+
+        // a new column position, so flakes do not fall along the same lines forever
+        positionX[i] = volumeMin.x + rng.NextFloat() * volumeSize.x;
+        positionZ[i] = volumeMin.z + rng.NextFloat() * volumeSize.z;
+
+        if (initial) {
+            positionY[i] = volumeMin.y + rng.NextFloat() * volumeSize.y;
+            velocityX[i] = rng.NextFloat() * 0.4f - 0.2f;
+            velocityZ[i] = rng.NextFloat() * 0.4f - 0.2f;
+            velocityY[i] = -(rng.NextFloat() * 0.6f + 0.4f);
+            size[i] = rng.NextFloat() * 0.8f + 0.8f;
+            lifetime[i] = rng.NextFloat() * 10.0f;
+        }
+        else {
+            // the height is set by the caller
+            velocityY[i] = -(rng.NextFloat() + 0.4f);
+            lifetime[i] = 0.0f;
+        }
+    }
+
+    void SnowSimulation::UpdateRange(int begin, int end, float deltaTime, glm::vec4* output) {
+
+        float* __restrict px = positionX.data();
+        float* __restrict py = positionY.data();
+        float* __restrict pz = positionZ.data();
+        const float* __restrict vx = velocityX.data();
+        const float* __restrict vy = velocityY.data();
+        const float* __restrict vz = velocityZ.data();
+        float* __restrict life = lifetime.data();
+
+        float minX = volumeMin.x, minZ = volumeMin.z;
+        float sizeX = volumeSize.x, sizeZ = volumeSize.z;
+        float invSizeX = 1.0f / sizeX, invSizeZ = 1.0f / sizeZ;
+
+        // branch free, vectorized by the compiler; x and z wrap around the volume (torus),
+        // so the camera walking forward keeps the same density around it
+        for (int i = begin; i < end; i++) {
+            float x = px[i] + vx[i] * deltaTime - minX;
+            float z = pz[i] + vz[i] * deltaTime - minZ;
+            px[i] = minX + x - sizeX * std::floor(x * invSizeX);
+            pz[i] = minZ + z - sizeZ * std::floor(z * invSizeZ);
+            py[i] += vy[i] * deltaTime;
+            life[i] += deltaTime;
+        }
+
+        // the ground test and leaving vertically go on the scalar path while writing the output
+        Xoshiro128& rng = ThreadRandom();
+        float minY = volumeMin.y, maxY = volumeMin.y + volumeSize.y;
+        for (int i = begin; i < end; i++) {
+            bool landed = surface != NULL && py[i] < surface->GetHeight(px[i], pz[i]);
+            if (landed || py[i] < minY || py[i] >= maxY) {
+                // flakes that hit something start again at the top, the others wrap around
+                // the height, keeping the fall continuous
+                float y = py[i] - minY;
+                py[i] = landed ? maxY - rng.NextFloat() * 0.5f : minY + y - volumeSize.y * std::floor(y / volumeSize.y);
+                if (landed || y < 0.0f) {
+                    Respawn(i, rng, false);
+                }
+            }
+            output[i] = glm::vec4(px[i], py[i], pz[i], size[i]);
+        }
+    }
+
+    void SnowSimulation::Update(JobSystem* jobs, float deltaTime, glm::vec3 volumeMin, glm::vec3 volumeSize,
+        const Heightfield* surface, glm::vec4* output) {
+
+        this->volumeMin = volumeMin;
+        this->volumeSize = volumeSize;
+        this->surface = surface;
+
+        if (jobs == NULL) {
+            UpdateRange(0, particleCount, deltaTime, output);
+            return;
+        }
+
+        jobs->ParallelFor(particleCount, CHUNK_SIZE, [this, deltaTime, output](int begin, int end) {
+            UpdateRange(begin, end, deltaTime, output);
+        });
+    }
+
+    int SnowSimulation::GetParticleCount() const {
+
+        return particleCount;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef SnowSimulation_hpp
+#define SnowSimulation_hpp
+
+#include <glm/glm.hpp>
+
+#include "JobSystem.hpp"
+#include "Random.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    class Heightfield;
+
+    // CPU snow stored as a structure of arrays: the integration loop walks plain float arrays,
+    // which the compiler turns into SSE/AVX2/NEON code, and runs in chunks on the job system.
+    // The particles live in a box that follows the camera: leaving it sideways wraps them to the
+    // opposite side, falling through the bottom or onto a surface respawns them at the top.
+    class SnowSimulation {
+
+    public:
+        static const int CHUNK_SIZE = 4096;
+
+        void Create(int particleCount, glm::vec3 volumeMin, glm::vec3 volumeSize);
+
+        // advances every particle and writes position and size (xyz, w) to output (particleCount
+        // entries, usually mapped GPU memory); jobs == NULL runs on the calling thread,
+        // surface == NULL lets the flakes fall to the bottom of the volume
+        void Update(JobSystem* jobs, float deltaTime, glm::vec3 volumeMin, glm::vec3 volumeSize,
+            const Heightfield* surface, glm::vec4* output);
+
+        int GetParticleCount() const;
+
+    private:
+        int particleCount;
+
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> velocityX, velocityY, velocityZ;
+        std::vector<float> size;
+        std::vector<float> lifetime;
+
+        glm::vec3 volumeMin, volumeSize;
+        const Heightfield* surface;
+
+        void UpdateRange(int begin, int end, float deltaTime, glm::vec4* output);
+        void Respawn(int i, Xoshiro128& rng, bool initial);
+    };
+}
+
+#endif /* SnowSimulation_hpp */
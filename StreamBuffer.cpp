@@ -0,0 +1,129 @@
+#include "StreamBuffer.hpp"
+
+#include <iostream>
+
+namespace gps {
+
+    // 1 ms, the wait loop repeats until the fence is signaled
+    const GLuint64 FENCE_TIMEOUT = 1000000;
+
+    void StreamBuffer::Create(GLsizeiptr bytesPerFrame) {
+
+        sectionSize = bytesPerFrame;
+        section = 0;
+        sectionOffset = 0;
+        persistentPointer = NULL;
+        overflowReported = false;
+        for (int i = 0; i < FRAME_COUNT; i++) {
+            fences[i] = 0;
+        }
+
+        // GL_COPY_WRITE_BUFFER is not used for drawing, so binding it does not disturb any VAO state
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+#if defined (__APPLE__)
+        persistent = false;
+#else
+        persistent = GLEW_ARB_buffer_storage != 0;
+        if (persistent) {
+            // coherent: writes become visible to the GPU without explicit flushes
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, sectionSize * FRAME_COUNT, NULL, flags);
+            persistentPointer = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, sectionSize * FRAME_COUNT, flags);
+            persistent = persistentPointer != NULL;
+        }
+#endif
+        if (!persistent) {
+            glBufferData(GL_COPY_WRITE_BUFFER, sectionSize * FRAME_COUNT, NULL, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        std::cout << "Stream buffer: " << (persistent ? "persistent mapping" : "unsynchronized glMapBufferRange")
+            << ", " << FRAME_COUNT << " x " << sectionSize / 1024 << " KB" << std::endl;
+    }
+
+    void StreamBuffer::Delete() {
+
+        for (int i = 0; i < FRAME_COUNT; i++) {
+            if (fences[i] != 0)
+                glDeleteSync(fences[i]);
+        }
+
+        if (persistent) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+
+    void StreamBuffer::BeginFrame() {
+
+        section = (section + 1) % FRAME_COUNT;
+        sectionOffset = 0;
+
+        GLsync fence = fences[section];
+        if (fence == 0)
+            return;
+
+        // the first wait flushes the command stream, otherwise the fence might never be reached
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;) {
+            GLenum result = glClientWaitSync(fence, flags, FENCE_TIMEOUT);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+                break;
+            flags = 0;
+        }
+        glDeleteSync(fence);
+        fences[section] = 0;
+    }
+
+    void StreamBuffer::EndFrame() {
+
+        fences[section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void* StreamBuffer::Map(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset) {
+
+        GLsizeiptr aligned = (alignment > 1) ? (sectionOffset + alignment - 1) / alignment * alignment : sectionOffset;
+        if (aligned + size > sectionSize) {
+            if (!overflowReported) {
+                std::cout << "Stream buffer: frame section of " << sectionSize << " bytes is full" << std::endl;
+                overflowReported = true;
+            }
+            return NULL;
+        }
+
+        offset = section * sectionSize + aligned;
+        sectionOffset = aligned + size;
+
+        if (persistent)
+            return persistentPointer + offset;
+
+        // the fences already guarantee the GPU is not reading this range
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        return glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    }
+
+    void StreamBuffer::Unmap() {
+
+        if (persistent)
+            return;
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    GLuint StreamBuffer::GetBuffer() const {
+
+        return buffer;
+    }
+
+    bool StreamBuffer::IsPersistent() const {
+
+        return persistent;
+    }
+}
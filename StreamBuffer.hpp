@@ -0,0 +1,54 @@
+#ifndef StreamBuffer_hpp
+#define StreamBuffer_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+namespace gps {
+
+    // Ring allocator for data that is rewritten every frame (particles, per-draw uniforms, debug lines).
+    // The buffer is split in FRAME_COUNT sections; a frame bump-allocates from its own section and
+    // fences it, so the CPU only waits if it gets FRAME_COUNT frames ahead of the GPU.
+    // With ARB_buffer_storage the whole buffer stays persistently mapped and Map() is just a pointer
+    // bump, otherwise every Map() is an unsynchronized glMapBufferRange of the range (the fences
+    // still keep it safe).
+    class StreamBuffer {
+
+    public:
+        static const int FRAME_COUNT = 3;
+
+        void Create(GLsizeiptr bytesPerFrame);
+        void Delete();
+
+        // waits until the GPU is done with the section this frame reuses
+        void BeginFrame();
+        // fences the section of this frame
+        void EndFrame();
+
+        // returns a write-only pointer to size bytes and their offset inside the buffer,
+        // NULL when the section of this frame is full; every successful Map() needs its Unmap()
+        void* Map(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset);
+        void Unmap();
+
+        GLuint GetBuffer() const;
+        bool IsPersistent() const;
+
+    private:
+        GLuint buffer;
+        GLsizeiptr sectionSize;
+        bool persistent;
+        char* persistentPointer;
+
+        int section;
+        GLsizeiptr sectionOffset;
+        GLsync fences[FRAME_COUNT];
+        bool overflowReported;
+    };
+}
+
+#endif /* StreamBuffer_hpp */
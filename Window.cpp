@@ -2,9 +2,9 @@
 
 namespace gps {
 
-    void Window::Create(int width, int height, const char *title) {
+    bool Window::CreateGLFWWindow(int width, int height, const char *title, bool headless) {
         if (!glfwInit()) {
-            throw std::runtime_error("Could not start GLFW3!");
+            return false;
         }
 
         //window hints
@@ -22,14 +22,34 @@ namespace gps {
         //for antialising
         glfwWindowHint(GLFW_SAMPLES, 4);
 
+        //headless frames go to an offscreen framebuffer, the window only carries the context
+        glfwWindowHint(GLFW_VISIBLE, headless ? GLFW_FALSE : GLFW_TRUE);
+
         this->window = glfwCreateWindow(width, height, title, NULL, NULL);
         if (!this->window) {
+            glfwTerminate();
+            return false;
+        }
+        return true;
+    }
+
+    void Window::Create(int width, int height, const char *title, bool headless) {
+        bool created = false;
+#if defined (GLFW_PLATFORM_NULL)
+        if (headless) {
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+            created = CreateGLFWWindow(width, height, title, headless);
+            // no OSMesa/EGL for the null platform: an invisible window on the default one
+            glfwInitHint(GLFW_PLATFORM, GLFW_ANY_PLATFORM);
+        }
+#endif
+        if (!created && !CreateGLFWWindow(width, height, title, headless)) {
             throw std::runtime_error("Could not create GLFW3 window!");
         }
 
         glfwMakeContextCurrent(window);
 
-        glfwSwapInterval(1);
+        // the swap interval is set by gps::FramePacer from the present mode
 
 #if not defined (__APPLE__)
         // start GLEW extension handler
@@ -24,7 +24,9 @@ namespace gps {
     class Window {
 
     public:
-        void Create(int width=800, int height=600, const char *title="OpenGL Project");
+        // headless: the window is never shown; with GLFW 3.4 it is first tried on the null
+        // platform, which needs no window system at all (Mesa llvmpipe on a server)
+        void Create(int width=800, int height=600, const char *title="OpenGL Project", bool headless=false);
         void Delete();
 
         GLFWwindow* getWindow();
@@ -34,6 +36,8 @@ namespace gps {
     private:
         WindowDimensions dimensions;
         GLFWwindow *window;
+
+        bool CreateGLFWWindow(int width, int height, const char *title, bool headless);
     };
 }
 
@@ -18,12 +18,40 @@
 #include "Camera.hpp"
 #include "Model3D.hpp"
 #include "SkyBox.hpp"
+#include "CascadedShadowMap.hpp"
+#include "ClusteredLighting.hpp"
+#include "DeferredRenderer.hpp"
+#include "RenderGraph.hpp"
+#include "JobSystem.hpp"
+#include "StreamBuffer.hpp"
+#include "GpuSnow.hpp"
+#include "SnowSimulation.hpp"
+#include "ParticleSystem.hpp"
+#include "Heightfield.hpp"
+#include "Bvh.hpp"
+#include "FramePacer.hpp"
+#include "InputQueue.hpp"
+#include "GpuProfiler.hpp"
+#include "CpuProfiler.hpp"
+#include "CameraPath.hpp"
+#include "Benchmark.hpp"
+#include "Scatter.hpp"
 
 #include <iostream>
 #include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
 
 gps::Window myWindow;
-const unsigned int SHADOW_WIDTH = 4096, SHADOW_HEIGHT = 4096;
+const int SHADOW_CASCADE_COUNT = 4;
+const int SHADOW_CASCADE_RESOLUTION = 1024;
+
+const float CAMERA_FOV = 45.0f;
+const float CAMERA_NEAR = 0.1f;
+const float CAMERA_FAR = 200.0f;
 
 enum RenderMode { SOLID = 0, WIREFRAME = 1, POINT = 2 };
 RenderMode currentRenderMode = SOLID;
@@ -33,7 +61,8 @@ gps::Camera myCamera(
     glm::vec3(0.0f, 0.0f, -10.0f),
     glm::vec3(0.0f, 1.0f, 0.0f)
 );
-float cameraSpeed = 0.5f;
+// meters per second
+float cameraSpeed = 30.0f;
 
 glm::mat4 model;
 glm::mat4 view;
@@ -46,9 +75,17 @@ gps::Shader skyboxShader;
 
 glm::vec3 lightDir;
 glm::vec3 lightColor;
-glm::vec3 pointLightPos;
 glm::vec3 pointLightColor;
 
+// attenuation constants, must match basic.frag
+const float LIGHT_CONSTANT = 1.0f;
+const float LIGHT_LINEAR = 0.7f;
+const float LIGHT_QUADRATIC = 1.8f;
+
+// every point light of the frame, assigned to froxels by lightClusterer
+std::vector<gps::PointLight> pointLights;
+gps::LightClusterer lightClusterer;
+
 GLint modelLoc, viewLoc, projectionLoc, normalMatrixLoc;
 GLint lightDirLoc, lightColorLoc;
 
@@ -69,10 +106,7 @@ gps::SkyBox mySkyBox;
 gps::SkyBox myNightSkyBox;
 
 GLboolean pressedKeys[1024];
-float angle = 0.0f;
-float bladesAngle = 0.0f;
 bool startTour = false;
-float tourAngle = 0.0f;
 bool fogEnabled = false;
 GLint fogEnabledLoc;
 
@@ -82,30 +116,263 @@ GLfloat yaw = -90.0f;
 GLfloat pitch = 0.0f;
 GLfloat sensitivity = 0.1f;
 
-GLuint shadowMapFBO;
-GLuint depthMapTexture;
+gps::CascadedShadowMap shadowCascades;
+glm::vec3 cachedShadowLightDir;
+
+struct SceneObject {
+    gps::Model3D* model;
+    // index of the model in sceneModels, groups draws that share textures
+    int modelId;
+    glm::mat4 modelMatrix;
+    // world space bounding sphere, used to cull shadow casters and the view frustum
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+    // recomputes modelMatrix every frame, NULL for static objects
+    glm::mat4 (*animate)();
+};
 
-struct SnowParticle {
-    glm::vec3 position;
-    glm::vec3 velocity;
-    float size;
-    float lifetime;
+std::vector<gps::Model3D*> sceneModels;
+std::vector<SceneObject> staticObjects;
+std::vector<SceneObject> dynamicObjects;
+
+// one visible object of the frame, everything the GL thread needs to issue the draw
+struct DrawItem {
+    gps::Model3D* model;
+    // DrawUniforms of the object inside frameStream
+    GLintptr uniformOffset;
+    uint64_t sortKey;
+    bool visible;
 };
 
-std::vector<SnowParticle> snowParticles;
-const int MAX_SNOW_PARTICLES = 50000;
+// DrawData block of basic.vert and depthPrepass.vert (std140)
+struct DrawUniforms {
+    glm::mat4 model;
+    glm::mat4 normalMatrix;
+};
+const GLuint DRAW_DATA_BINDING = 0;
+
+// per-frame streamed data: per-draw uniforms and snow positions
+const GLsizeiptr FRAME_STREAM_SIZE = 8 * 1024 * 1024;
+gps::StreamBuffer frameStream;
+GLint uniformBufferAlignment = 256;
+
+// filled by prepareFrame on the job system, consumed by the camera passes
+gps::JobSystem jobSystem;
+std::vector<DrawItem> preparedItems;
+std::vector<DrawItem> drawList;
+
+// --snow-particles; the volume follows the camera, so the same density as the old
+// 100 x 100 m field needs about half the particles
+int snowParticleCount = 25000;
 bool snowEnabled = false;
 
-GLuint snowVAO, snowVBO;
+// the snow box around the camera, 10 m below to 20 m above the eye but never under the ground
+const glm::vec3 SNOW_VOLUME_SIZE(60.0f, 30.0f, 60.0f);
+const float SNOW_VOLUME_BELOW = 10.0f;
+// below the lowest point of the ground mesh
+const float SNOW_GROUND = -2.0f;
+
+// flake radius in meters for size 1, clamped on screen to keep the fill cost predictable
+const float SNOW_FLAKE_RADIUS = 0.04f;
+const float SNOW_MIN_PIXEL_RADIUS = 1.0f;
+const float SNOW_MAX_PIXEL_RADIUS = 12.0f;
+// past SNOW_THIN_START fewer flakes are drawn, down to SNOW_THIN_KEEP of them at SNOW_MAX_DISTANCE
+const float SNOW_THIN_START = 15.0f;
+const float SNOW_MAX_DISTANCE = 45.0f;
+const float SNOW_THIN_KEEP = 0.3f;
+
+// CPU particles, their positions of the current frame are written into frameStream
+gps::SnowSimulation snowSimulation;
+GLintptr snowUploadOffset = 0;
+bool snowUploaded = false;
+
+GLuint snowVAO;
 gps::Shader snowShader;
 
+// --snow-resolution half|quarter (full by default): snow is drawn into a 1/2 or 1/4 resolution target, depth tested
+// against a downsampled copy of the scene depth, and upsampled onto the screen
+int snowResolutionScale = 1;
+gps::Shader snowDepthDownsampleShader;
+gps::Shader snowCompositeShader;
+
+// measures the CPU snow update and exits (--snow-benchmark)
+bool snowBenchmark = false;
+
+// transform feedback simulation instead of the CPU particles (--gpu-snow)
+bool gpuSnowEnabled = false;
+gps::GpuSnow gpuSnow;
+gps::Shader snowUpdateShader;
+
 glm::vec3 lanternWorldPos = glm::vec3(-7.0f, -0.4f, -1.0f);
 glm::vec3 campfireWorldPos = glm::vec3(-7.0f, -1.1f, -5.0f);
+glm::vec3 windmillPos = glm::vec3(20.0f, 20.0f, 100.0f);
 
 bool lanternLightEnabled = true;
 bool campfireLightEnabled = true;
 bool sunLightEnabled = true; 
 
+// the campfire mesh is modelled away from its origin, this is where the flames are
+const glm::vec3 CAMPFIRE_FLAME_OFFSET = glm::vec3(-10.0f, 0.5f, -40.0f);
+
+// top-down height of the static geometry, baked once: the ground alone for the camera, which can
+// still walk under roofs and tree crowns, everything static for the snow, which lands on them
+gps::Heightfield terrainHeightfield;
+gps::Heightfield surfaceHeightfield;
+const float HEIGHTFIELD_CELL_SIZE = 0.5f;
+const float CAMERA_EYE_HEIGHT = 1.0f;
+
+// Camera movement and animation advance in fixed steps, whatever the frame rate; each frame
+// draws a blend of the last two steps, so motion stays smooth between them.
+const double SIMULATION_STEP = 1.0 / 60.0;
+// after a long stall (window drag, breakpoint) the simulation skips ahead instead of catching up
+const int MAX_SIMULATION_STEPS = 8;
+// degrees per second
+const float TEAPOT_ROTATION_SPEED = 60.0f;
+const float BLADES_ROTATION_SPEED = 60.0f;
+const float TOUR_SPEED = 30.0f;
+
+struct SimulationState {
+    glm::vec3 cameraPosition;
+    // Q/E
+    float teapotAngle;
+    float bladesAngle;
+    float tourAngle;
+    // meters along the benchmark camera path
+    float pathDistance;
+};
+SimulationState previousState;
+SimulationState currentState;
+// the blend drawn this frame
+SimulationState renderState;
+double simulationAccumulator = 0.0;
+
+// --headless: the window stays hidden and frames are drawn into headlessFramebuffer instead of
+// the default framebuffer; --frames ends the run, --screenshot saves the last frame as PPM
+bool headless = false;
+int windowWidth = 1024;
+int windowHeight = 768;
+// 0 runs until the window is closed; a headless run defaults to a single frame
+int frameCount = 0;
+std::string screenshotPath;
+GLuint headlessFramebuffer = 0;
+GLuint headlessColorBuffer = 0;
+GLuint headlessDepthBuffer = 0;
+// the framebuffer the render graph presents to
+GLuint backbufferFramebuffer = 0;
+bool presentModeSet = false;
+
+// present mode (--present vsync|adaptive|uncapped|limited, cycled with V) and the target of
+// the frame limiter (--fps-limit, which also selects limited)
+gps::FramePacer framePacer;
+gps::PresentMode presentMode = gps::PRESENT_VSYNC;
+double frameLimit = 60.0;
+const int FRAME_PACING_REPORT_FRAMES = 600;
+
+// GPU time of every render graph pass and of the whole frame (--gpu-profile file.csv|file.json);
+// the report is rewritten with every frame pacing report and at exit
+gps::GpuProfiler gpuProfiler;
+std::string gpuProfilePath;
+
+// Chrome trace of the CPU zones of cpuTraceFrames frames (--cpu-trace file.json, or T at runtime)
+std::string cpuTracePath = "cpu_trace.json";
+int cpuTraceFrames = 120;
+bool cpuTraceAtStartup = false;
+
+// --benchmark report.json: the camera follows benchmarkPath (--benchmark-path, the tour orbit by
+// default) one fixed step per frame with fog, snow and every light on, and input ignored; the
+// frame times after the warm-up are written as JSON
+bool benchmarkEnabled = false;
+std::string benchmarkReportPath;
+std::string benchmarkPathFile;
+int benchmarkWarmupFrames = 120;
+// 0: as many frames as one pass along the path takes
+int benchmarkFrames = 0;
+gps::CameraPath benchmarkPath;
+gps::Benchmark benchmark;
+
+// generated on top of the hand-placed scene over the ground, for frame time against scene size:
+// --stress-objects N copies of the scene models, --stress-lights M point lights and
+// --stress-particles K particles, laid out by --stress-layout grid|poisson from --stress-seed
+int stressObjectCount = 0;
+int stressLightCount = 0;
+int stressParticleCount = 0;
+gps::ScatterLayout stressLayout = gps::SCATTER_POISSON;
+uint64_t stressSeed = 1;
+std::vector<gps::PointLight> stressLights;
+// one ember system per this many particles
+const int STRESS_PARTICLES_PER_SYSTEM = 1024;
+
+// GLFW callbacks only queue their events; the frame applies them before the simulation and
+// once more right before it is built, so the view holds the newest mouse movement
+gps::InputQueue inputQueue;
+// key and button events read by the late latch, applied at the start of the next frame
+std::vector<gps::InputEvent> deferredInput;
+// mouse movements applied to this frame's view: count, sum and oldest of their timestamps
+int frameInputCount = 0;
+double frameInputTimeSum = 0.0;
+double frameInputOldest = 0.0;
+
+// input to photon latency: from the mouse events of a frame until the GPU has finished it
+// (GL_TIMESTAMP after the swap; scanout adds up to one refresh interval on top)
+const int LATENCY_QUERY_COUNT = 8;
+GLuint latencyQueries[LATENCY_QUERY_COUNT];
+bool latencyQueryPending[LATENCY_QUERY_COUNT];
+int latencyInputCount[LATENCY_QUERY_COUNT];
+double latencyInputTimeSum[LATENCY_QUERY_COUNT];
+double latencyInputOldest[LATENCY_QUERY_COUNT];
+int latencyQueryIndex = 0;
+// glfwGetTime() minus the GPU clock, in seconds
+double gpuClockOffset = 0.0;
+double latencySum = 0.0;
+double latencyMax = 0.0;
+int latencyEvents = 0;
+
+// static objects for camera collision and picking, in the order of staticObjects
+gps::SceneBvh sceneBvh;
+const float CAMERA_RADIUS = 0.3f;
+// kept between the camera sphere and a surface it slides along
+const float CAMERA_SKIN = 0.01f;
+
+// campfire sparks and smoke; the instances of the current frame are written into frameStream
+gps::ParticleEngine particleEngine;
+int campfireSparks;
+int campfireSmoke;
+const float CAMPFIRE_SPARK_RATE = 60.0f;
+const float CAMPFIRE_SMOKE_RATE = 25.0f;
+GLintptr particleUploadOffset = 0;
+bool particlesUploaded = false;
+GLuint particleVAO;
+gps::Shader particleShader;
+
+// shadow filter kernel for basic.frag: "1", "4", "9", "16" taps or "poisson" (--pcf)
+std::string pcfKernel = "4";
+
+// G-buffer + full-screen lighting instead of the forward pass (--deferred)
+bool deferredShading = false;
+gps::DeferredRenderer deferredRenderer;
+gps::Shader gBufferShader;
+gps::Shader deferredDirectionalShader;
+gps::Shader deferredPointLightShader;
+
+// depth-only pass before the main pass, which then shades only the visible fragments (Z)
+bool depthPrepassEnabled = false;
+gps::Shader depthPrepassShader;
+
+// GL_SAMPLES_PASSED of the main pass, read back a few frames later so the GPU never stalls
+const int OVERDRAW_QUERY_COUNT = 3;
+const int OVERDRAW_REPORT_FRAMES = 120;
+GLuint overdrawQueries[OVERDRAW_QUERY_COUNT];
+bool overdrawQueryPending[OVERDRAW_QUERY_COUNT];
+int overdrawQueryIndex = 0;
+GLint overdrawPixelSamples = 1;
+double overdrawSum = 0.0;
+int overdrawFrames = 0;
+
+// passes of the current frame, see renderScene
+gps::RenderGraph renderGraph;
+// last printed layout of the graph, the new one is printed when a toggle changes it
+std::string renderGraphLayout;
+
 GLenum glCheckError_(const char* file, int line) {
     GLenum errorCode;
     while ((errorCode = glGetError()) != GL_NO_ERROR) {
@@ -123,17 +390,7 @@ GLenum glCheckError_(const char* file, int line) {
 }
 #define glCheckError() glCheckError_(__FILE__, __LINE__)
 
-glm::mat4 computeLightSpaceTrMatrix() {
-    glm::mat4 lightProjection = glm::ortho(-150.0f, 150.0f, -150.0f, 150.0f, 0.1f, 400.0f);
-    glm::vec3 lightPos = normalize(lightDir) * 150.0f;
-    glm::vec3 target = glm::vec3(0.0f, 0.0f, 50.0f);
-    glm::mat4 lightView = glm::lookAt(lightPos, target, glm::vec3(0.0f, 1.0f, 0.0f));
-    return lightProjection * lightView;
-}
-
-void drawModel(gps::Model3D& modelObj, gps::Shader& shader, glm::vec3 position, glm::vec3 scale = glm::vec3(1.0f), float rotAngle = 0.0f, glm::vec3 rotAxis = glm::vec3(0, 1, 0)) {
-    shader.useShaderProgram();
-
+glm::mat4 computeModelMatrix(glm::vec3 position, glm::vec3 scale = glm::vec3(1.0f), float rotAngle = 0.0f, glm::vec3 rotAxis = glm::vec3(0, 1, 0)) {
     glm::mat4 m = glm::mat4(1.0f);
     m = glm::translate(m, position);
 
@@ -142,6 +399,20 @@ void drawModel(gps::Model3D& modelObj, gps::Shader& shader, glm::vec3 position,
     }
 
     m = glm::scale(m, scale);
+    return m;
+}
+
+void computeBoundingSphere(gps::Model3D& modelObj, const glm::mat4& m, glm::vec3& center, float& radius) {
+    glm::vec3 boundsMin = modelObj.GetBoundsMin();
+    glm::vec3 boundsMax = modelObj.GetBoundsMax();
+    center = glm::vec3(m * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+
+    float maxScale = glm::max(glm::length(glm::vec3(m[0])), glm::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+    radius = glm::length(boundsMax - boundsMin) * 0.5f * maxScale;
+}
+
+void drawModel(gps::Model3D& modelObj, gps::Shader& shader, const glm::mat4& m) {
+    shader.useShaderProgram();
 
     glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(m));
 
@@ -153,13 +424,32 @@ void drawModel(gps::Model3D& modelObj, gps::Shader& shader, glm::vec3 position,
     modelObj.Draw(shader);
 }
 
+void drawModel(gps::Model3D& modelObj, gps::Shader& shader, glm::vec3 position, glm::vec3 scale = glm::vec3(1.0f), float rotAngle = 0.0f, glm::vec3 rotAxis = glm::vec3(0, 1, 0)) {
+    drawModel(modelObj, shader, computeModelMatrix(position, scale, rotAngle, rotAxis));
+}
+
 void windowResizeCallback(GLFWwindow* window, int width, int height) {
     fprintf(stdout, "Window resized! New width: %d , and height: %d\n", width, height);
 }
 
-void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
+void restoreRenderMode() {
+    if (currentRenderMode == WIREFRAME) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    else if (currentRenderMode == POINT) glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+    else glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
+void startCpuTrace() {
+#if defined(GPS_CPU_PROFILER)
+    gps::CpuProfiler::StartCapture(cpuTraceFrames, cpuTracePath);
+    std::cout << "CPU trace: capturing " << cpuTraceFrames << " frames" << std::endl;
+#else
+    std::cout << "CPU trace: the profiler zones are compiled out of this build (define GPS_CPU_PROFILER)" << std::endl;
+#endif
+}
+
+void handleKey(int key, int action) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, GL_TRUE);
+        glfwSetWindowShouldClose(myWindow.getWindow(), GL_TRUE);
 
     if (key >= 0 && key < 1024) {
         if (action == GLFW_PRESS) pressedKeys[key] = true;
@@ -185,9 +475,20 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
             myBasicShader.useShaderProgram();
             glUniform1i(fogEnabledLoc, fogEnabled);
         }
+        else if (key == GLFW_KEY_Z) {
+            depthPrepassEnabled = !depthPrepassEnabled;
+            std::cout << "Depth pre-pass: " << (depthPrepassEnabled ? "ON" : "OFF") << std::endl;
+        }
         else if (key == GLFW_KEY_P) {
             startTour = !startTour;
         }
+        else if (key == GLFW_KEY_T) {
+            startCpuTrace();
+        }
+        else if (key == GLFW_KEY_V) {
+            framePacer.SetMode((gps::PresentMode)((framePacer.GetMode() + 1) % gps::PRESENT_MODE_COUNT));
+            std::cout << "Present mode: " << gps::FramePacer::GetModeName(framePacer.GetMode()) << std::endl;
+        }
         else if (key == GLFW_KEY_N) {
             snowEnabled = !snowEnabled;
         }
@@ -201,6 +502,10 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
         }
         else if (key == GLFW_KEY_K && action == GLFW_PRESS) {
             sunLightEnabled = !sunLightEnabled;
+            // the shadow pass was culled while the sun was off, its cache is out of date
+            if (sunLightEnabled) {
+                shadowCascades.InvalidateStatic();
+            }
             myBasicShader.useShaderProgram();
             GLint sunEnabledLoc = glGetUniformLocation(myBasicShader.shaderProgram, "sunEnabled");
             glUniform1i(sunEnabledLoc, sunLightEnabled);
@@ -209,7 +514,7 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
     }
 }
 
-void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
+void handleMouseMove(double xpos, double ypos) {
     if (firstMouse) {
         lastX = xpos; lastY = ypos; firstMouse = false;
     }
@@ -224,32 +529,171 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
     if (pitch < -89.0f) pitch = -89.0f;
 
     myCamera.rotate(pitch, yaw);
-    view = myCamera.getViewMatrix();
-    myBasicShader.useShaderProgram();
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
 }
 
-void processMovement() {
-    const GLfloat MIN_CAMERA_HEIGHT = 0.0f;
+// moves the camera sphere from -> to, sliding along whatever it hits
+glm::vec3 resolveCameraMovement(glm::vec3 from, glm::vec3 to) {
+    glm::vec3 position = from;
+    glm::vec3 movement = to - from;
+
+    // a corner needs a slide along each of its walls
+    for (int iteration = 0; iteration < 3; iteration++) {
+        if (glm::dot(movement, movement) < 1e-10f) {
+            break;
+        }
 
-    if (startTour) {
-        tourAngle += 0.5f;
+        gps::RayHit hit;
+        if (!sceneBvh.SphereCast(position, movement, CAMERA_RADIUS, 1.0f, hit)) {
+            position += movement;
+            break;
+        }
+
+        // up to the contact, minus the skin, then only what is left along the surface
+        float length = glm::length(movement);
+        float t = std::max(hit.t - CAMERA_SKIN / length, 0.0f);
+        position += movement * t;
+        movement *= 1.0f - t;
+        movement -= hit.normal * std::min(glm::dot(movement, hit.normal), 0.0f);
+    }
+    return position;
+}
+
+// left click: what is under the crosshair
+void handleMouseButton(int button, int action) {
+    if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS) {
+        return;
+    }
+
+    gps::RayHit hit;
+    if (sceneBvh.Raycast(myCamera.getPosition(), myCamera.getFrontDirection(), CAMERA_FAR, hit)) {
+        std::cout << "Picked: " << staticObjects[hit.instance].model->GetFileName() << " at " << hit.t << " m" << std::endl;
+    }
+    else {
+        std::cout << "Picked: nothing" << std::endl;
+    }
+}
+
+void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
+    gps::InputEvent event = { gps::INPUT_KEY, glfwGetTime(), key, action, 0.0, 0.0 };
+    inputQueue.Push(event);
+}
+
+void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
+    gps::InputEvent event = { gps::INPUT_MOUSE_MOVE, glfwGetTime(), 0, 0, xpos, ypos };
+    inputQueue.Push(event);
+}
+
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+    gps::InputEvent event = { gps::INPUT_MOUSE_BUTTON, glfwGetTime(), button, action, 0.0, 0.0 };
+    inputQueue.Push(event);
+}
+
+// applies the queued events in the order they arrived
+void applyInputEvent(const gps::InputEvent& event) {
+    // a benchmark run can only be cancelled
+    if (benchmarkEnabled && !(event.type == gps::INPUT_KEY && event.code == GLFW_KEY_ESCAPE)) {
+        return;
+    }
+    switch (event.type) {
+    case gps::INPUT_KEY:
+        handleKey(event.code, event.action);
+        break;
+    case gps::INPUT_MOUSE_MOVE:
+        handleMouseMove(event.x, event.y);
+        if (frameInputCount == 0) {
+            frameInputOldest = event.time;
+        }
+        frameInputCount++;
+        frameInputTimeSum += event.time;
+        break;
+    case gps::INPUT_MOUSE_BUTTON:
+        handleMouseButton(event.code, event.action);
+        break;
+    }
+}
+
+// mouseOnly applies just the mouse movement and keeps the other events for the next full call,
+// so toggles never change the scene between the updates and the render of a frame
+void processInput(bool mouseOnly = false) {
+    PROFILE_ZONE("processInput");
+    if (!mouseOnly) {
+        // they were queued before anything still in the ring
+        for (size_t i = 0; i < deferredInput.size(); i++) {
+            applyInputEvent(deferredInput[i]);
+        }
+        deferredInput.clear();
+    }
+    gps::InputEvent event;
+    while (inputQueue.Pop(event)) {
+        if (mouseOnly && event.type != gps::INPUT_MOUSE_MOVE) {
+            deferredInput.push_back(event);
+            continue;
+        }
+        applyInputEvent(event);
+    }
+}
+
+// one fixed step of input and animation
+void processMovement(float deltaTime) {
+    PROFILE_ZONE("processMovement");
+    previousState = currentState;
+    SimulationState& state = currentState;
+
+    state.bladesAngle += BLADES_ROTATION_SPEED * deltaTime;
+
+    if (benchmarkEnabled) {
+        // the camera waits at the start of the path during the warm-up
+        if (!benchmark.IsWarmingUp()) {
+            state.pathDistance += benchmarkPath.GetSpeed() * deltaTime;
+        }
+        glm::vec3 target;
+        benchmarkPath.Evaluate(state.pathDistance, state.cameraPosition, target);
+    }
+    else if (startTour) {
+        state.tourAngle += TOUR_SPEED * deltaTime;
         float radius = 30.0f;
-        float camX = sin(glm::radians(tourAngle)) * radius;
-        float camZ = cos(glm::radians(tourAngle)) * radius;
-        myCamera.setPosition(glm::vec3(camX, 5.0f, camZ));
-        view = glm::lookAt(glm::vec3(camX, 10.0f, camZ), glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        state.cameraPosition = glm::vec3(sin(glm::radians(state.tourAngle)) * radius, 5.0f, cos(glm::radians(state.tourAngle)) * radius);
     }
     else {
-        if (pressedKeys[GLFW_KEY_W]) myCamera.move(gps::MOVE_FORWARD, cameraSpeed);
-        if (pressedKeys[GLFW_KEY_S]) myCamera.move(gps::MOVE_BACKWARD, cameraSpeed);
-        if (pressedKeys[GLFW_KEY_A]) myCamera.move(gps::MOVE_LEFT, cameraSpeed);
-        if (pressedKeys[GLFW_KEY_D]) myCamera.move(gps::MOVE_RIGHT, cameraSpeed);
+        myCamera.setPosition(state.cameraPosition);
+        float distance = cameraSpeed * deltaTime;
+        if (pressedKeys[GLFW_KEY_W]) myCamera.move(gps::MOVE_FORWARD, distance);
+        if (pressedKeys[GLFW_KEY_S]) myCamera.move(gps::MOVE_BACKWARD, distance);
+        if (pressedKeys[GLFW_KEY_A]) myCamera.move(gps::MOVE_LEFT, distance);
+        if (pressedKeys[GLFW_KEY_D]) myCamera.move(gps::MOVE_RIGHT, distance);
+
+        if (pressedKeys[GLFW_KEY_Q]) state.teapotAngle -= TEAPOT_ROTATION_SPEED * deltaTime;
+        if (pressedKeys[GLFW_KEY_E]) state.teapotAngle += TEAPOT_ROTATION_SPEED * deltaTime;
 
-        if (pressedKeys[GLFW_KEY_Q]) angle -= 1.0f;
-        if (pressedKeys[GLFW_KEY_E]) angle += 1.0f;
+        state.cameraPosition = resolveCameraMovement(state.cameraPosition, myCamera.getPosition());
+    }
 
+    // follows the terrain, but may fly above it
+    float minCameraHeight = terrainHeightfield.GetHeight(state.cameraPosition.x, state.cameraPosition.z) + CAMERA_EYE_HEIGHT;
+    state.cameraPosition.y = std::max(state.cameraPosition.y, minCameraHeight);
+}
+
+// renderState and the view matrix at alpha between the last two steps
+void updateView(float alpha) {
+    renderState.cameraPosition = glm::mix(previousState.cameraPosition, currentState.cameraPosition, alpha);
+    renderState.teapotAngle = glm::mix(previousState.teapotAngle, currentState.teapotAngle, alpha);
+    renderState.bladesAngle = glm::mix(previousState.bladesAngle, currentState.bladesAngle, alpha);
+    renderState.tourAngle = glm::mix(previousState.tourAngle, currentState.tourAngle, alpha);
+    renderState.pathDistance = glm::mix(previousState.pathDistance, currentState.pathDistance, alpha);
+
+    myCamera.setPosition(renderState.cameraPosition);
+    if (benchmarkEnabled) {
+        glm::vec3 position, target;
+        benchmarkPath.Evaluate(renderState.pathDistance, position, target);
+        view = glm::lookAt(renderState.cameraPosition, target, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+    else if (startTour) {
+        float radius = 30.0f;
+        float camX = sin(glm::radians(renderState.tourAngle)) * radius;
+        float camZ = cos(glm::radians(renderState.tourAngle)) * radius;
+        view = glm::lookAt(glm::vec3(camX, 10.0f, camZ), glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+    else {
         view = myCamera.getViewMatrix();
     }
 
@@ -257,21 +701,106 @@ void processMovement() {
     glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
     normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
     glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+}
+
+void initSimulation() {
+    currentState.cameraPosition = myCamera.getPosition();
+    currentState.teapotAngle = 0.0f;
+    currentState.bladesAngle = 0.0f;
+    currentState.tourAngle = 0.0f;
+    currentState.pathDistance = 0.0f;
+    previousState = currentState;
+    renderState = currentState;
+    simulationAccumulator = 0.0;
+}
 
-    glm::vec3 currentPosition = myCamera.getPosition();
-    if (currentPosition.y < MIN_CAMERA_HEIGHT) {
-        myCamera.setPosition(glm::vec3(currentPosition.x, MIN_CAMERA_HEIGHT, currentPosition.z));
+// late latch: the mouse movement that arrived while the frame was simulated goes into its view
+void latchCameraOrientation() {
+    glfwPollEvents();
+    processInput(true);
+    updateView((float)(simulationAccumulator / SIMULATION_STEP));
+}
+
+// runs the fixed steps that fit in the elapsed time, then interpolates the view
+void advanceSimulation(double frameTime) {
+    simulationAccumulator += frameTime;
+    int steps = 0;
+    while (simulationAccumulator >= SIMULATION_STEP && steps < MAX_SIMULATION_STEPS) {
+        processMovement((float)SIMULATION_STEP);
+        simulationAccumulator -= SIMULATION_STEP;
+        steps++;
     }
+    if (steps == MAX_SIMULATION_STEPS) {
+        simulationAccumulator = std::min(simulationAccumulator, SIMULATION_STEP);
+    }
+    updateView((float)(simulationAccumulator / SIMULATION_STEP));
 }
 
 void initOpenGLWindow() {
-    myWindow.Create(1024, 768, "OpenGL Project Core");
+    myWindow.Create(windowWidth, windowHeight, "OpenGL Project Core", headless);
+}
+
+// single sampled sRGB color + depth, the size of the window's framebuffer
+void initHeadlessFramebuffer() {
+    if (!headless) {
+        return;
+    }
+    int width = myWindow.getWindowDimensions().width;
+    int height = myWindow.getWindowDimensions().height;
+
+    glGenRenderbuffers(1, &headlessColorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, headlessColorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, width, height);
+    glGenRenderbuffers(1, &headlessDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, headlessDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &headlessFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, headlessFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headlessColorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, headlessDepthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Headless framebuffer is incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    backbufferFramebuffer = headlessFramebuffer;
+}
+
+// binary PPM of the backbuffer, read before the swap
+void saveScreenshot(const std::string& path) {
+    int width = myWindow.getWindowDimensions().width;
+    int height = myWindow.getWindowDimensions().height;
+    std::vector<unsigned char> pixels((size_t)width * height * 3);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, backbufferFramebuffer);
+    if (backbufferFramebuffer == 0) {
+        glReadBuffer(GL_BACK);
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        std::cerr << "Could not write screenshot: " << path << std::endl;
+        return;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    // GL rows start at the bottom
+    for (int y = height - 1; y >= 0; y--) {
+        fwrite(&pixels[(size_t)y * width * 3], 1, (size_t)width * 3, file);
+    }
+    fclose(file);
+    std::cout << "Screenshot: " << path << std::endl;
 }
 
 void setWindowCallbacks() {
     glfwSetWindowSizeCallback(myWindow.getWindow(), windowResizeCallback);
     glfwSetKeyCallback(myWindow.getWindow(), keyboardCallback);
     glfwSetCursorPosCallback(myWindow.getWindow(), mouseCallback);
+    glfwSetMouseButtonCallback(myWindow.getWindow(), mouseButtonCallback);
 }
 
 void initOpenGLState() {
@@ -285,21 +814,25 @@ void initOpenGLState() {
     glFrontFace(GL_CCW);
 }
 
+void initStreamBuffer() {
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformBufferAlignment);
+    // the CPU snow positions and the particle instances come on top of the per-draw data
+    GLsizeiptr snowBytes = gpuSnowEnabled ? 0 : snowParticleCount * sizeof(glm::vec4);
+    GLsizeiptr particleBytes = particleEngine.GetTotalCapacity() * sizeof(gps::ParticleInstance);
+    // and a stress scene can have more objects than FRAME_STREAM_SIZE holds DrawUniforms slots
+    GLsizeiptr stride = (sizeof(DrawUniforms) + uniformBufferAlignment - 1) / uniformBufferAlignment * uniformBufferAlignment;
+    GLsizeiptr objectBytes = (GLsizeiptr)(staticObjects.size() + dynamicObjects.size()) * stride;
+    frameStream.Create(FRAME_STREAM_SIZE + snowBytes + particleBytes + objectBytes + uniformBufferAlignment);
+}
+
 void initFBO() {
-    glGenFramebuffers(1, &shadowMapFBO);
-    glGenTextures(1, &depthMapTexture);
-    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMapTexture, 0);
-    glDrawBuffer(GL_NONE); glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    shadowCascades.Create(SHADOW_CASCADE_RESOLUTION, SHADOW_CASCADE_COUNT);
+    lightClusterer.Create(jobSystem);
+
+    // the fullscreen triangle also serves the low resolution snow passes
+    if (deferredShading || snowResolutionScale > 1) {
+        deferredRenderer.Create();
+    }
 }
 
 void initModels() {
@@ -321,11 +854,228 @@ void initModels() {
 	campfire.LoadModel("models/campfire/campfire.obj");
 }
 
+int getModelId(gps::Model3D* modelObj) {
+    for (size_t i = 0; i < sceneModels.size(); i++) {
+        if (sceneModels[i] == modelObj) {
+            return (int)i;
+        }
+    }
+    sceneModels.push_back(modelObj);
+    return (int)sceneModels.size() - 1;
+}
+
+void addStaticObject(gps::Model3D& modelObj, const glm::mat4& modelMatrix) {
+    SceneObject object;
+    object.model = &modelObj;
+    object.modelId = getModelId(&modelObj);
+    object.modelMatrix = modelMatrix;
+    computeBoundingSphere(modelObj, object.modelMatrix, object.boundsCenter, object.boundsRadius);
+    object.animate = NULL;
+    staticObjects.push_back(object);
+}
+
+void addStaticObject(gps::Model3D& modelObj, glm::vec3 position, glm::vec3 scale = glm::vec3(1.0f), float rotAngle = 0.0f, glm::vec3 rotAxis = glm::vec3(0, 1, 0)) {
+    addStaticObject(modelObj, computeModelMatrix(position, scale, rotAngle, rotAxis));
+}
+
+glm::mat4 computeTeapotMatrix() {
+    return computeModelMatrix(glm::vec3(-5.0f, -3.0f, 5.0f), glm::vec3(0.25f), renderState.teapotAngle);
+}
+
+glm::mat4 computeBladesMatrix() {
+    glm::mat4 modelBlades = glm::mat4(1.0f);
+    modelBlades = glm::translate(modelBlades, windmillPos);
+    modelBlades = glm::translate(modelBlades, glm::vec3(0.0f, 4.0f, -2.8f));
+    modelBlades = glm::rotate(modelBlades, glm::radians(renderState.bladesAngle), glm::vec3(0.0f, 0.0f, 1.0f));
+    modelBlades = glm::scale(modelBlades, glm::vec3(0.5f));
+    return modelBlades;
+}
+
+void addDynamicObject(gps::Model3D& modelObj, glm::mat4 (*animate)()) {
+    SceneObject object;
+    object.model = &modelObj;
+    object.modelId = getModelId(&modelObj);
+    object.animate = animate;
+    object.modelMatrix = animate();
+    computeBoundingSphere(modelObj, object.modelMatrix, object.boundsCenter, object.boundsRadius);
+    dynamicObjects.push_back(object);
+}
+
+// xz rectangle covered by the ground mesh
+bool getGroundArea(glm::vec2& areaMin, glm::vec2& areaMax, glm::mat4& groundMatrix) {
+    for (size_t i = 0; i < staticObjects.size(); i++) {
+        const SceneObject& object = staticObjects[i];
+        if (object.model != &ground) {
+            continue;
+        }
+
+        glm::vec3 boundsMin = glm::vec3(object.modelMatrix * glm::vec4(ground.GetBoundsMin(), 1.0f));
+        glm::vec3 boundsMax = glm::vec3(object.modelMatrix * glm::vec4(ground.GetBoundsMax(), 1.0f));
+        areaMin = glm::vec2(std::min(boundsMin.x, boundsMax.x), std::min(boundsMin.z, boundsMax.z));
+        areaMax = glm::vec2(std::max(boundsMin.x, boundsMax.x), std::max(boundsMin.z, boundsMax.z));
+        groundMatrix = object.modelMatrix;
+        return true;
+    }
+    return false;
+}
+
+// over the area of the ground mesh; everything outside is SNOW_GROUND
+void bakeHeightfields() {
+    glm::vec2 areaMin, areaMax;
+    glm::mat4 groundMatrix;
+    if (getGroundArea(areaMin, areaMax, groundMatrix)) {
+        terrainHeightfield.Create(areaMin, areaMax, HEIGHTFIELD_CELL_SIZE, SNOW_GROUND);
+        terrainHeightfield.AddModel(ground, groundMatrix);
+        surfaceHeightfield.Create(areaMin, areaMax, HEIGHTFIELD_CELL_SIZE, SNOW_GROUND);
+        for (size_t i = 0; i < staticObjects.size(); i++) {
+            surfaceHeightfield.AddModel(*staticObjects[i].model, staticObjects[i].modelMatrix);
+        }
+        surfaceHeightfield.CreateTexture();
+    }
+}
+
+// copies of the scene models standing on the terrain, each turned by a random angle
+void addStressObjects() {
+    struct StressModel {
+        gps::Model3D* model;
+        float scale;
+    };
+    const StressModel models[] = {
+        { &watchTower, 1.0f }, { &house, 1.0f }, { &trees, 1.0f }, { &big_tree, 1.0f }, { &big_tree2, 1.0f },
+        { &big_tree3, 1.0f }, { &lantern, 0.5f }, { &well, 1.0f }, { &casuta, 1.0f }, { &bear, 0.5f },
+        { &windmillBase, 0.5f }, { &campfire, 1.0f }, { &teapot, 0.25f }
+    };
+    const int MODEL_COUNT = sizeof(models) / sizeof(models[0]);
+
+    glm::vec2 areaMin, areaMax;
+    glm::mat4 groundMatrix;
+    if (stressObjectCount == 0 || !getGroundArea(areaMin, areaMax, groundMatrix)) {
+        return;
+    }
+
+    gps::Xoshiro128 rng;
+    rng.Seed(stressSeed);
+    std::vector<glm::vec2> points = gps::ScatterPoints(stressLayout, stressObjectCount, areaMin, areaMax, rng);
+    for (size_t i = 0; i < points.size(); i++) {
+        const StressModel& stressModel = models[i % MODEL_COUNT];
+        gps::Model3D& modelObj = *stressModel.model;
+
+        // the model's bounding box is centered on the point, its bottom on the terrain
+        glm::mat4 m = computeModelMatrix(glm::vec3(0.0f), glm::vec3(stressModel.scale), rng.NextFloat(0.0f, 360.0f));
+        glm::vec3 center = glm::vec3(m * glm::vec4((modelObj.GetBoundsMin() + modelObj.GetBoundsMax()) * 0.5f, 1.0f));
+        float bottom = modelObj.GetBoundsMin().y * stressModel.scale;
+        float terrain = terrainHeightfield.GetHeight(points[i].x, points[i].y);
+        m[3] = glm::vec4(points[i].x - center.x, terrain - bottom, points[i].y - center.z, 1.0f);
+        addStaticObject(modelObj, m);
+    }
+}
+
+// static point lights a little above the terrain, in random colors
+void addStressLights() {
+    glm::vec2 areaMin, areaMax;
+    glm::mat4 groundMatrix;
+    stressLights.clear();
+    if (stressLightCount == 0 || !getGroundArea(areaMin, areaMax, groundMatrix)) {
+        return;
+    }
+
+    gps::Xoshiro128 rng;
+    rng.Seed(stressSeed + 1);
+    std::vector<glm::vec2> points = gps::ScatterPoints(stressLayout, stressLightCount, areaMin, areaMax, rng);
+    for (size_t i = 0; i < points.size(); i++) {
+        gps::PointLight light;
+        float height = rng.NextFloat(0.5f, 3.0f);
+        light.position = glm::vec3(points[i].x, terrainHeightfield.GetHeight(points[i].x, points[i].y) + height, points[i].y);
+        light.color = glm::vec3(rng.NextFloat(0.2f, 1.0f), rng.NextFloat(0.2f, 1.0f), rng.NextFloat(0.2f, 1.0f)) * 3.0f;
+        light.radius = gps::ComputeLightRadius(light.color, LIGHT_CONSTANT, LIGHT_LINEAR, LIGHT_QUADRATIC);
+        stressLights.push_back(light);
+    }
+}
+
+void buildSceneBvh() {
+    std::vector<gps::BvhInstance> instances;
+    for (size_t i = 0; i < staticObjects.size(); i++) {
+        gps::BvhInstance instance;
+        instance.bvh = &staticObjects[i].model->GetBvh();
+        instance.modelMatrix = staticObjects[i].modelMatrix;
+        instances.push_back(instance);
+    }
+    sceneBvh.Build(instances);
+}
+
+// objects that never move - their shadows are cached per cascade
+void initSceneObjects() {
+    staticObjects.clear();
+    addStaticObject(ground, glm::vec3(0.0f, -1.0f, 0.0f));
+    addStaticObject(watchTower, glm::vec3(2.0f, -1.0f, -3.0f));
+    addStaticObject(house, glm::vec3(-1.0f, -0.8f, -1.0f));
+    addStaticObject(fence, glm::vec3(0.0f, -1.0f, 0.0f));
+    addStaticObject(trees, glm::vec3(-2.0f, -1.0f, -2.0f));
+    addStaticObject(big_tree, glm::vec3(3.0f, -1.0f, -4.0f));
+    addStaticObject(big_tree2, glm::vec3(-3.0f, -1.0f, -4.0f));
+    addStaticObject(big_tree3, glm::vec3(0.0f, -1.0f, -5.0f));
+    addStaticObject(lantern, lanternWorldPos, glm::vec3(0.5f));
+    addStaticObject(well, glm::vec3(5.0f, -1.0f, 5.0f));
+    addStaticObject(casuta, glm::vec3(-5.0f, -3.0f, 5.0f));
+    addStaticObject(bear, glm::vec3(0.0f, -0.2f, -3.0f), glm::vec3(0.5f));
+    addStaticObject(windmillBase, windmillPos, glm::vec3(0.5f));
+    addStaticObject(campfire, campfireWorldPos);
+
+    // after the bake: rasterizing thousands of generated copies into the snow surface would
+    // only slow the startup, so the snow falls through them
+    bakeHeightfields();
+    addStressObjects();
+    addStressLights();
+    buildSceneBvh();
+
+    // animated objects - re-rendered into the shadow map every frame
+    dynamicObjects.clear();
+    addDynamicObject(teapot, computeTeapotMatrix);
+    addDynamicObject(windmillBlades, computeBladesMatrix);
+}
+
+std::string getShadowFilterDefines() {
+    if (pcfKernel == "poisson") {
+        return "#define PCF_POISSON\n";
+    }
+    if (pcfKernel == "1" || pcfKernel == "4" || pcfKernel == "9" || pcfKernel == "16") {
+        return "#define PCF_TAPS " + pcfKernel + "\n";
+    }
+    std::cout << "Unknown PCF kernel '" << pcfKernel << "', using 4 taps" << std::endl;
+    return "#define PCF_TAPS 4\n";
+}
+
+void bindDrawDataBlock(gps::Shader& shader) {
+    GLuint blockIndex = glGetUniformBlockIndex(shader.shaderProgram, "DrawData");
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shader.shaderProgram, blockIndex, DRAW_DATA_BINDING);
+    }
+}
+
 void initShaders() {
-    myBasicShader.loadShader("shaders/basic.vert", "shaders/basic.frag");
+    myBasicShader.loadShader("shaders/basic.vert", "shaders/basic.frag", getShadowFilterDefines());
     depthMapShader.loadShader("shaders/depthMap.vert", "shaders/depthMap.frag");
     skyboxShader.loadShader("shaders/skyboxShader.vert", "shaders/skyboxShader.frag");
     snowShader.loadShader("shaders/snow.vert", "shaders/snow.frag");
+    particleShader.loadShader("shaders/particle.vert", "shaders/particle.frag");
+    if (gpuSnowEnabled) {
+        snowUpdateShader.loadTransformFeedbackShader("shaders/snowUpdate.vert", gps::GpuSnow::GetFeedbackVaryings());
+    }
+    depthPrepassShader.loadShader("shaders/depthPrepass.vert", "shaders/depthMap.frag");
+    if (snowResolutionScale > 1) {
+        snowDepthDownsampleShader.loadShader("shaders/deferredLight.vert", "shaders/snowDepthDownsample.frag");
+        snowCompositeShader.loadShader("shaders/deferredLight.vert", "shaders/snowComposite.frag");
+    }
+
+    if (deferredShading) {
+        gBufferShader.loadShader("shaders/basic.vert", "shaders/gbuffer.frag");
+        deferredDirectionalShader.loadShader("shaders/deferredLight.vert", "shaders/deferredDirectional.frag", getShadowFilterDefines());
+        deferredPointLightShader.loadShader("shaders/deferredPointLight.vert", "shaders/deferredPointLight.frag");
+        bindDrawDataBlock(gBufferShader);
+    }
+
+    bindDrawDataBlock(myBasicShader);
+    bindDrawDataBlock(depthPrepassShader);
 }
 
 void initUniforms() {
@@ -337,7 +1087,7 @@ void initUniforms() {
     glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
     normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
     normalMatrixLoc = glGetUniformLocation(myBasicShader.shaderProgram, "normalMatrix");
-    projection = glm::perspective(glm::radians(45.0f), (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height, 0.1f, 200.0f);
+    projection = glm::perspective(glm::radians(CAMERA_FOV), (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height, CAMERA_NEAR, CAMERA_FAR);
     projectionLoc = glGetUniformLocation(myBasicShader.shaderProgram, "projection");
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
@@ -353,91 +1103,236 @@ void initUniforms() {
     glUniform1i(sunEnabledLoc, sunLightEnabled);
 
     pointLightColor = glm::vec3(1.0f, 0.6f, 0.0f);
-    glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "pointLightColor"), 1, glm::value_ptr(pointLightColor));
 
     fogEnabledLoc = glGetUniformLocation(myBasicShader.shaderProgram, "enableFog");
     glUniform1i(fogEnabledLoc, fogEnabled);
 }
 
+glm::vec3 getSnowVolumeMin(glm::vec3 center) {
+    glm::vec3 volumeMin = center - 0.5f * SNOW_VOLUME_SIZE;
+    volumeMin.y = std::max(center.y - SNOW_VOLUME_BELOW, SNOW_GROUND);
+    return volumeMin;
+}
+
 void initSnowParticles() {
-    snowParticles.reserve(MAX_SNOW_PARTICLES);
-
-    for (int i = 0; i < MAX_SNOW_PARTICLES; i++) {
-        SnowParticle particle;
-        particle.position = glm::vec3(
-            (rand() % 1000 - 500) / 10.0f, 
-            (rand() % 200) / 10.0f + 0.5f,  
-            (rand() % 1000 - 500) / 10.0f  
-        );
-        particle.velocity = glm::vec3(
-            (rand() % 20 - 10) / 50.0f,    
-            -(rand() % 30 + 20) / 50.0f,
-            (rand() % 20 - 10) / 50.0f
-        );
-        particle.size = (rand() % 80 + 80) / 100.0f;
-        particle.lifetime = (rand() % 100) / 10.0f;
-        snowParticles.push_back(particle);
+    if (gpuSnowEnabled) {
+        gpuSnow.Create(snowParticleCount);
+        return;
     }
 
+    snowSimulation.Create(snowParticleCount, getSnowVolumeMin(myCamera.getPosition()), SNOW_VOLUME_SIZE);
+
+    // position and size per instance, the pointers are set each frame to the stream offset
     glGenVertexArrays(1, &snowVAO);
-    glGenBuffers(1, &snowVBO);
+    glBindVertexArray(snowVAO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glBindVertexArray(0);
 }
 
 void updateSnowParticles(float deltaTime) {
+    PROFILE_ZONE("updateSnowParticles");
+    // nothing of this frame is in the stream buffer until the simulation below writes it
+    snowUploaded = false;
     if (!snowEnabled) return;
 
-    for (auto& particle : snowParticles) {
-        particle.position += particle.velocity * deltaTime;
-        particle.lifetime += deltaTime;
-
-        if (particle.position.y < -1.0f ||
-            abs(particle.position.x) > 100.0f ||
-            abs(particle.position.z) > 100.0f) {
+    glm::vec3 volumeMin = getSnowVolumeMin(myCamera.getPosition());
 
-            particle.position = glm::vec3(
-                (rand() % 1000 - 500) / 10.0f,  
-                (rand() % 100) / 10.0f + 0.5f, 
-                (rand() % 1000 - 500) / 10.0f
-            );
-            particle.velocity.y = -(rand() % 50 + 20) / 50.0f;
-            particle.lifetime = 0.0f;
+    if (gpuSnowEnabled) {
+        // transform feedback outside the render graph, timed as its own zone
+        if (!gpuProfilePath.empty()) {
+            gpuProfiler.Begin("snowUpdate");
         }
+        gpuSnow.Update(snowUpdateShader, deltaTime, volumeMin, SNOW_VOLUME_SIZE, surfaceHeightfield);
+        if (!gpuProfilePath.empty()) {
+            gpuProfiler.End();
+        }
+        return;
     }
+
+    // the simulation writes straight into this frame's section of the stream buffer
+    glm::vec4* particles = (glm::vec4*)frameStream.Map(snowParticleCount * sizeof(glm::vec4), sizeof(float), snowUploadOffset);
+    if (particles == NULL) {
+        return;
+    }
+    snowSimulation.Update(&jobSystem, deltaTime, volumeMin, SNOW_VOLUME_SIZE, &surfaceHeightfield, particles);
+    frameStream.Unmap();
+    snowUploaded = true;
 }
 
-void renderSnow() {
-    if (!snowEnabled || snowParticles.empty()) return;
+// camera facing quads, one instance per flake; far flakes are thinned out and everything past
+// SNOW_MAX_DISTANCE (or fully fogged) is culled in the vertex shader
+void renderSnow(int viewportHeight) {
+    snowShader.useShaderProgram();
+    GLuint program = snowShader.shaderProgram;
+
+    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform1f(glGetUniformLocation(program, "viewportHeight"), (float)viewportHeight);
+    glUniform1f(glGetUniformLocation(program, "flakeRadius"), SNOW_FLAKE_RADIUS);
+    // never smaller than a pixel of the target the flakes are drawn into
+    glUniform1f(glGetUniformLocation(program, "minPixelRadius"), SNOW_MIN_PIXEL_RADIUS * snowResolutionScale);
+    glUniform1f(glGetUniformLocation(program, "maxPixelRadius"), SNOW_MAX_PIXEL_RADIUS);
+    glUniform1f(glGetUniformLocation(program, "thinStart"), SNOW_THIN_START);
+    glUniform1f(glGetUniformLocation(program, "maxDistance"), SNOW_MAX_DISTANCE);
+    glUniform1f(glGetUniformLocation(program, "thinKeep"), SNOW_THIN_KEEP);
+    glUniform1i(glGetUniformLocation(program, "enableFog"), fogEnabled);
+
+    if (gpuSnowEnabled) {
+        gpuSnow.Draw();
+        return;
+    }
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDepthMask(GL_FALSE); 
+    glBindVertexArray(snowVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, frameStream.GetBuffer());
 
-    snowShader.useShaderProgram();
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)snowUploadOffset);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)(snowUploadOffset + 3 * sizeof(float)));
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, snowParticleCount);
+    glBindVertexArray(0);
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(snowShader.shaderProgram, "view"),
-        1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(snowShader.shaderProgram, "projection"),
-        1, GL_FALSE, glm::value_ptr(projection));
+// smoke rises and is pushed sideways by a slowly turning swirl, on top of the default forces
+void updateSmokeParticles(gps::ParticlePool& pool, const gps::EmitterDesc& emitter, float deltaTime) {
+    gps::IntegrateParticles(pool, emitter, deltaTime);
 
-    std::vector<glm::vec3> positions;
-    for (const auto& particle : snowParticles) {
-        positions.push_back(particle.position);
+    for (int i = 0; i < pool.alive; i++) {
+        pool.velocityX[i] += sin(pool.positionY[i] * 1.7f + pool.positionZ[i]) * 0.4f * deltaTime;
+        pool.velocityZ[i] += cos(pool.positionY[i] * 1.3f + pool.positionX[i]) * 0.4f * deltaTime;
     }
+}
 
-    glBindVertexArray(snowVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, snowVBO);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3),
-        positions.data(), GL_DYNAMIC_DRAW);
+// rising embers, emitted as fast as they die so the pools stay about full
+void addStressParticleSystems() {
+    glm::vec2 areaMin, areaMax;
+    glm::mat4 groundMatrix;
+    if (stressParticleCount == 0 || !getGroundArea(areaMin, areaMax, groundMatrix)) {
+        return;
+    }
+
+    int systemCount = (stressParticleCount + STRESS_PARTICLES_PER_SYSTEM - 1) / STRESS_PARTICLES_PER_SYSTEM;
+    gps::Xoshiro128 rng;
+    rng.Seed(stressSeed + 2);
+    std::vector<glm::vec2> points = gps::ScatterPoints(stressLayout, systemCount, areaMin, areaMax, rng);
+    for (int i = 0; i < systemCount; i++) {
+        int capacity = std::min(stressParticleCount - i * STRESS_PARTICLES_PER_SYSTEM, STRESS_PARTICLES_PER_SYSTEM);
+
+        gps::EmitterDesc embers;
+        embers.shape = gps::EMITTER_DISC;
+        embers.position = glm::vec3(points[i].x, terrainHeightfield.GetHeight(points[i].x, points[i].y), points[i].y);
+        embers.extents = glm::vec3(1.0f);
+        embers.lifetimeMin = 1.0f;
+        embers.lifetimeMax = 3.0f;
+        embers.rate = capacity / 2.0f;
+        embers.velocity = glm::vec3(0.0f, 1.2f, 0.0f);
+        embers.velocityJitter = glm::vec3(0.4f, 0.4f, 0.4f);
+        embers.drag = 0.3f;
+        embers.sizeMin = 0.03f;
+        embers.sizeMax = 0.06f;
+        embers.colorStart = glm::vec4(1.0f, 0.6f, 0.2f, 1.0f);
+        embers.colorEnd = glm::vec4(1.0f, 0.1f, 0.0f, 0.0f);
+        embers.additive = true;
+        particleEngine.AddSystem(embers, capacity);
+    }
+}
 
+void initParticleSystems() {
+    glm::vec3 flame = campfireWorldPos + CAMPFIRE_FLAME_OFFSET;
+
+    // drawn first: additive, so they need no ordering against each other
+    gps::EmitterDesc sparks;
+    sparks.shape = gps::EMITTER_DISC;
+    sparks.position = flame;
+    sparks.extents = glm::vec3(0.3f);
+    sparks.rate = CAMPFIRE_SPARK_RATE;
+    sparks.lifetimeMin = 0.6f;
+    sparks.lifetimeMax = 1.6f;
+    sparks.velocity = glm::vec3(0.0f, 1.8f, 0.0f);
+    sparks.velocityJitter = glm::vec3(0.6f, 0.8f, 0.6f);
+    sparks.acceleration = glm::vec3(0.0f, -0.8f, 0.0f);
+    sparks.drag = 0.5f;
+    sparks.sizeMin = 0.03f;
+    sparks.sizeMax = 0.06f;
+    sparks.colorStart = glm::vec4(1.0f, 0.7f, 0.2f, 1.0f);
+    sparks.colorEnd = glm::vec4(1.0f, 0.2f, 0.0f, 0.0f);
+    sparks.additive = true;
+    campfireSparks = particleEngine.AddSystem(sparks, 256);
+
+    // alpha blended, sorted back to front every frame
+    gps::EmitterDesc smoke;
+    smoke.shape = gps::EMITTER_DISC;
+    smoke.position = flame + glm::vec3(0.0f, 0.4f, 0.0f);
+    smoke.extents = glm::vec3(0.25f);
+    smoke.rate = CAMPFIRE_SMOKE_RATE;
+    smoke.lifetimeMin = 3.0f;
+    smoke.lifetimeMax = 5.0f;
+    smoke.velocity = glm::vec3(0.0f, 0.9f, 0.0f);
+    smoke.velocityJitter = glm::vec3(0.15f, 0.2f, 0.15f);
+    smoke.drag = 0.1f;
+    smoke.sizeMin = 0.3f;
+    smoke.sizeMax = 0.5f;
+    smoke.sizeGrowth = 0.5f;
+    smoke.colorStart = glm::vec4(0.35f, 0.33f, 0.3f, 0.5f);
+    smoke.colorEnd = glm::vec4(0.6f, 0.6f, 0.6f, 0.0f);
+    campfireSmoke = particleEngine.AddSystem(smoke, 256, updateSmokeParticles);
+
+    addStressParticleSystems();
+
+    // position + size and color per instance, the pointers are set at draw time
+    glGenVertexArrays(1, &particleVAO);
+    glBindVertexArray(particleVAO);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glBindVertexArray(0);
+}
 
-    glUniform1f(glGetUniformLocation(snowShader.shaderProgram, "pointSize"), 10.0f);
+void updateParticleSystems(float deltaTime) {
+    PROFILE_ZONE("updateParticleSystems");
+    // a put out fire stops emitting, the live particles fade away
+    particleEngine.GetSystem(campfireSparks).GetEmitter().rate = campfireLightEnabled ? CAMPFIRE_SPARK_RATE : 0.0f;
+    particleEngine.GetSystem(campfireSmoke).GetEmitter().rate = campfireLightEnabled ? CAMPFIRE_SMOKE_RATE : 0.0f;
+    particleEngine.Update(&jobSystem, deltaTime);
+}
 
-    glDrawArrays(GL_POINTS, 0, positions.size());
+// after the late latch: the alpha blended systems are sorted with the view of the frame
+void writeParticleInstances() {
+    PROFILE_ZONE("writeParticleInstances");
+    particlesUploaded = false;
+    gps::ParticleInstance* instances = (gps::ParticleInstance*)frameStream.Map(
+        particleEngine.GetTotalCapacity() * sizeof(gps::ParticleInstance), sizeof(float), particleUploadOffset);
+    if (instances == NULL) {
+        return;
+    }
+    particleEngine.WriteInstances(&jobSystem, view, instances);
+    frameStream.Unmap();
+    particlesUploaded = true;
+}
+
+void renderParticles() {
+    particleShader.useShaderProgram();
+    glUniformMatrix4fv(glGetUniformLocation(particleShader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(particleShader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+
+    glBindVertexArray(particleVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, frameStream.GetBuffer());
 
-    glDepthMask(GL_TRUE);
-    glDisable(GL_BLEND);
+    GLsizei stride = sizeof(gps::ParticleInstance);
+    for (int i = 0; i < particleEngine.GetSystemCount(); i++) {
+        int count = particleEngine.GetInstanceCount(i);
+        if (count == 0) {
+            continue;
+        }
+        GLintptr offset = particleUploadOffset + particleEngine.GetFirstInstance(i) * stride;
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(glm::vec4)));
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    }
+    glBindVertexArray(0);
 }
 
 void initSkybox() {
@@ -461,107 +1356,1011 @@ void initSkybox() {
 	myNightSkyBox.Load(darkFaces);
 }
 
-void renderAllObjects(gps::Shader shader) {
+// cascade < 0 draws every object, otherwise only the casters overlapping that shadow cascade
+void renderStaticObjects(gps::Shader shader, int cascade = -1) {
 
-    drawModel(teapot, shader, glm::vec3(-5.0f, -3.0f, 5.0f), glm::vec3(0.25f), angle);
-    drawModel(ground, shader, glm::vec3(0.0f, -1.0f, 0.0f));
-    drawModel(watchTower, shader, glm::vec3(2.0f, -1.0f, -3.0f));
-    drawModel(house, shader, glm::vec3(-1.0f, -0.8f, -1.0f));
-    drawModel(fence, shader, glm::vec3(0.0f, -1.0f, 0.0f));
-    drawModel(trees, shader, glm::vec3(-2.0f, -1.0f, -2.0f));
-    drawModel(big_tree, shader, glm::vec3(3.0f, -1.0f, -4.0f));
-    drawModel(big_tree2, shader, glm::vec3(-3.0f, -1.0f, -4.0f));
-    drawModel(big_tree3, shader, glm::vec3(0.0f, -1.0f, -5.0f));
+    for (size_t i = 0; i < staticObjects.size(); i++) {
+        const SceneObject& object = staticObjects[i];
+        if (cascade >= 0 && !shadowCascades.IsVisible(cascade, object.boundsCenter, object.boundsRadius)) {
+            continue;
+        }
+        drawModel(*object.model, shader, object.modelMatrix);
+    }
+}
+
+// matrices and bounds come from the last prepareFrame
+void renderDynamicObjects(gps::Shader shader, int cascade = -1) {
 
-    lanternWorldPos = glm::vec3(-7.0f, -0.4f, -1.0f);
+    for (size_t i = 0; i < dynamicObjects.size(); i++) {
+        const SceneObject& object = dynamicObjects[i];
+        if (cascade >= 0 && !shadowCascades.IsVisible(cascade, object.boundsCenter, object.boundsRadius)) {
+            continue;
+        }
+        drawModel(*object.model, shader, object.modelMatrix);
+    }
+}
 
-    drawModel(lantern, shader, lanternWorldPos, glm::vec3(0.5f));
-    drawModel(well, shader, glm::vec3(5.0f, -1.0f, 5.0f));
-    drawModel(casuta, shader, glm::vec3(-5.0f, -3.0f, 5.0f));
-    drawModel(bear, shader, glm::vec3(0.0f, -0.2f, -3.0f), glm::vec3(0.5f));
+// planes as (normal, d), a point is inside when dot(normal, p) + d >= 0 for all of them
+void extractFrustumPlanes(const glm::mat4& m, glm::vec4 planes[6]) {
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        planes[2 * i] = rows[3] + rows[i];
+        planes[2 * i + 1] = rows[3] - rows[i];
+    }
+    for (int i = 0; i < 6; i++) {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+// Frame preparation: animation, view frustum culling, normal matrices and sort keys for every
+// object are computed on the job system, the GL thread then only walks the sorted drawList.
+void prepareFrame() {
+    PROFILE_ZONE("prepareFrame");
+    glm::vec4 planes[6];
+    extractFrustumPlanes(projection * view, planes);
+
+    // front to back for early depth rejection; with the pre-pass depth is already resolved,
+    // so draws are grouped by model to save texture binds instead
+    bool groupByModel = depthPrepassEnabled;
+
+    int staticCount = (int)staticObjects.size();
+    int objectCount = staticCount + (int)dynamicObjects.size();
+    preparedItems.resize(objectCount);
+
+    // one aligned DrawUniforms slot per object, the jobs write their slots in place
+    GLsizeiptr stride = (sizeof(DrawUniforms) + uniformBufferAlignment - 1) / uniformBufferAlignment * uniformBufferAlignment;
+    GLintptr uniformBase = 0;
+    char* uniformSlots = (char*)frameStream.Map(stride * objectCount, uniformBufferAlignment, uniformBase);
+    if (uniformSlots == NULL) {
+        drawList.clear();
+        return;
+    }
 
-    glm::vec3 windmillPos = glm::vec3(20.0f, 20.0f, 100.0f);
-    drawModel(windmillBase, shader, windmillPos, glm::vec3(0.5f));
+    jobSystem.ParallelFor(objectCount, 64, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            SceneObject& object = (i < staticCount) ? staticObjects[i] : dynamicObjects[i - staticCount];
+            DrawItem& item = preparedItems[i];
+
+            if (object.animate != NULL) {
+                object.modelMatrix = object.animate();
+                computeBoundingSphere(*object.model, object.modelMatrix, object.boundsCenter, object.boundsRadius);
+            }
+
+            item.model = object.model;
+            item.visible = true;
+            for (int p = 0; p < 6 && item.visible; p++) {
+                item.visible = glm::dot(glm::vec3(planes[p]), object.boundsCenter) + planes[p].w >= -object.boundsRadius;
+            }
+            if (!item.visible) {
+                continue;
+            }
+
+            DrawUniforms* uniforms = (DrawUniforms*)(uniformSlots + stride * i);
+            uniforms->model = object.modelMatrix;
+            uniforms->normalMatrix = glm::mat4(glm::mat3(glm::inverseTranspose(view * object.modelMatrix)));
+            item.uniformOffset = uniformBase + stride * i;
+
+            // positive floats keep their order when compared as integers
+            float depth = glm::max(-(view * glm::vec4(object.boundsCenter, 1.0f)).z, 0.0f);
+            uint32_t depthBits;
+            std::memcpy(&depthBits, &depth, sizeof(depthBits));
+            uint64_t modelBits = (uint64_t)object.modelId;
+            item.sortKey = groupByModel ? (modelBits << 32) | depthBits : ((uint64_t)depthBits << 32) | modelBits;
+        }
+    });
+    frameStream.Unmap();
 
-    campfireWorldPos = glm::vec3(-7.0f, -1.1f, -5.0f);
-    drawModel(campfire, shader, campfireWorldPos);
+    drawList.clear();
+    for (int i = 0; i < objectCount; i++) {
+        if (preparedItems[i].visible) {
+            drawList.push_back(preparedItems[i]);
+        }
+    }
+    std::sort(drawList.begin(), drawList.end(), [](const DrawItem& a, const DrawItem& b) {
+        return a.sortKey < b.sortKey;
+    });
+}
 
-    bladesAngle += 1.0f;
+// camera passes draw the prepared list, the shadow cascades cull the scene themselves
+void renderAllObjects(gps::Shader shader) {
     shader.useShaderProgram();
-    glm::mat4 modelBlades = glm::mat4(1.0f);
-    modelBlades = glm::translate(modelBlades, windmillPos);
-    modelBlades = glm::translate(modelBlades, glm::vec3(0.0f, 4.0f, -2.8f));
-    modelBlades = glm::rotate(modelBlades, glm::radians(bladesAngle), glm::vec3(0.0f, 0.0f, 1.0f));
-    modelBlades = glm::scale(modelBlades, glm::vec3(0.5f));
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(modelBlades));
-    if (glGetUniformLocation(shader.shaderProgram, "normalMatrix") != -1) {
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * modelBlades));
-        glUniformMatrix3fv(glGetUniformLocation(shader.shaderProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normalMatrix));
+
+    for (size_t i = 0; i < drawList.size(); i++) {
+        const DrawItem& item = drawList[i];
+        glBindBufferRange(GL_UNIFORM_BUFFER, DRAW_DATA_BINDING, frameStream.GetBuffer(), item.uniformOffset, sizeof(DrawUniforms));
+        item.model->Draw(shader);
     }
-    windmillBlades.Draw(shader);
 }
-void renderScene() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    depthMapShader.useShaderProgram();
-    glUniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "lightSpaceTrMatrix"),
-        1, GL_FALSE, glm::value_ptr(computeLightSpaceTrMatrix()));
+// call after moving or adding static geometry so the cached shadow casters are re-rendered
+void invalidateStaticShadows() {
+    shadowCascades.InvalidateStatic();
+}
 
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
+void renderShadowMap() {
+    if (lightDir != cachedShadowLightDir) {
+        invalidateStaticShadows();
+        cachedShadowLightDir = lightDir;
+    }
 
-    glCullFace(GL_FRONT);
-    renderAllObjects(depthMapShader);
-    glCullFace(GL_BACK);
+    float aspect = (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height;
+    shadowCascades.Update(view, glm::radians(CAMERA_FOV), aspect, CAMERA_NEAR, CAMERA_FAR, lightDir);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    depthMapShader.useShaderProgram();
+    GLint lightSpaceTrMatrixLoc = glGetUniformLocation(depthMapShader.shaderProgram, "lightSpaceTrMatrix");
 
-    glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
-    myBasicShader.useShaderProgram();
+    for (int i = 0; i < shadowCascades.GetCascadeCount(); i++) {
+        // far cascades are refreshed every few frames only
+        if (!shadowCascades.IsDue(i)) {
+            continue;
+        }
 
-    glUniformMatrix4fv(glGetUniformLocation(myBasicShader.shaderProgram, "lightSpaceTrMatrix"),
-        1, GL_FALSE, glm::value_ptr(computeLightSpaceTrMatrix()));
+        glUniformMatrix4fv(lightSpaceTrMatrixLoc, 1, GL_FALSE, glm::value_ptr(shadowCascades.GetLightSpaceMatrix(i)));
 
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-    glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "shadowMap"), 3);
+        // static casters only when the cascade moved by a texel or the cache was invalidated
+        if (shadowCascades.NeedsStaticRefresh(i)) {
+            shadowCascades.BeginStatic(i);
+            renderStaticObjects(depthMapShader, i);
+        }
+
+        shadowCascades.BeginDynamic(i);
+        renderDynamicObjects(depthMapShader, i);
+    }
+}
 
-    glm::vec3 lightSourcePos = lanternWorldPos + glm::vec3(-6.0f, 0.5f, -1.5f);
-    glm::vec3 lightPosEye = glm::vec3(view * glm::vec4(lightSourcePos, 1.0f));
-    glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "pointLightPos"), 1, glm::value_ptr(lightPosEye));
+void addPointLight(glm::vec3 position, glm::vec3 color) {
+    gps::PointLight light;
+    light.position = position;
+    light.color = color;
+    light.radius = gps::ComputeLightRadius(color, LIGHT_CONSTANT, LIGHT_LINEAR, LIGHT_QUADRATIC);
+    pointLights.push_back(light);
+}
 
-    glm::vec3 lanternColor = lanternLightEnabled ? glm::vec3(1.0f, 0.6f, 0.0f) : glm::vec3(0.0f, 0.0f, 0.0f);
-    glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "pointLightColor"), 1, glm::value_ptr(lanternColor));
+// switched off lights are left out of the list, so they cost nothing in the shader
+void updatePointLights() {
+    pointLights.clear();
 
-    glm::vec3 fireSourcePos = campfireWorldPos + glm::vec3(-10.0f, 0.5f, -40.0f); 
-    glm::vec3 firePosEye = glm::vec3(view * glm::vec4(fireSourcePos, 1.0f));
-    glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "campfirePos"), 1, glm::value_ptr(firePosEye));
+    if (lanternLightEnabled) {
+        addPointLight(lanternWorldPos + glm::vec3(-6.0f, 0.5f, -1.5f), pointLightColor);
+    }
 
-    glm::vec3 fireColor;
     if (campfireLightEnabled) {
         float time = glfwGetTime();
         float flicker = 0.8f + (sin(time * 10.0f) * 0.1f) + (cos(time * 23.0f) * 0.1f);
-        fireColor = glm::vec3(1.0f, 0.4f, 0.0f) * flicker * 5.0f;
+        addPointLight(campfireWorldPos + CAMPFIRE_FLAME_OFFSET, glm::vec3(1.0f, 0.4f, 0.0f) * flicker * 5.0f);
     }
-    else {
-        fireColor = glm::vec3(0.0f, 0.0f, 0.0f); 
+
+    pointLights.insert(pointLights.end(), stressLights.begin(), stressLights.end());
+}
+
+void setShadowUniforms(gps::Shader& shader, gps::RenderPassContext& context, gps::RenderResource shadowMap) {
+    shader.useShaderProgram();
+
+    for (int i = 0; i < shadowCascades.GetCascadeCount(); i++) {
+        std::string index = "[" + std::to_string(i) + "]";
+        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, ("lightSpaceTrMatrices" + index).c_str()),
+            1, GL_FALSE, glm::value_ptr(shadowCascades.GetLightSpaceMatrix(i)));
+        glUniform1f(glGetUniformLocation(shader.shaderProgram, ("cascadeSplits" + index).c_str()),
+            shadowCascades.GetSplitDistance(i));
     }
-    glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "campfireColor"), 1, glm::value_ptr(fireColor));
+    glUniform1i(glGetUniformLocation(shader.shaderProgram, "cascadeCount"), shadowCascades.GetCascadeCount());
 
-    renderAllObjects(myBasicShader);
+    // without the sun the shaders skip computeShadow, but the unused sampler still needs a unit of its own:
+    // a draw fails validation if samplers of different types share one
     if (sunLightEnabled) {
-        mySkyBox.Draw(skyboxShader, view, projection);
+        context.BindTexture(shader, "shadowMap", shadowMap);
     }
     else {
-        myNightSkyBox.Draw(skyboxShader, view, projection);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "shadowMap"), context.AllocateTextureUnits(1));
+    }
+}
+
+void initOverdrawQueries() {
+    glGenQueries(OVERDRAW_QUERY_COUNT, overdrawQueries);
+    for (int i = 0; i < OVERDRAW_QUERY_COUNT; i++) {
+        overdrawQueryPending[i] = false;
+    }
+    // the G-buffer and the headless framebuffer are single sampled, the default framebuffer may be multisampled
+    glGetIntegerv(GL_SAMPLES, &overdrawPixelSamples);
+    if (deferredShading || headless || overdrawPixelSamples < 1) {
+        overdrawPixelSamples = 1;
+    }
+}
+
+void collectOverdrawQuery(int index) {
+    if (!overdrawQueryPending[index]) {
+        return;
+    }
+
+    GLuint available = 0;
+    glGetQueryObjectuiv(overdrawQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return;
+    }
+
+    GLuint samplesPassed = 0;
+    glGetQueryObjectuiv(overdrawQueries[index], GL_QUERY_RESULT, &samplesPassed);
+    overdrawQueryPending[index] = false;
+
+    double pixelSamples = (double)myWindow.getWindowDimensions().width * myWindow.getWindowDimensions().height * overdrawPixelSamples;
+    overdrawSum += samplesPassed / pixelSamples;
+    overdrawFrames++;
+
+    if (overdrawFrames == OVERDRAW_REPORT_FRAMES) {
+        std::cout << "Overdraw: " << overdrawSum / overdrawFrames << " shaded samples per pixel (depth pre-pass "
+            << (depthPrepassEnabled ? "ON" : "OFF") << ")" << std::endl;
+        overdrawSum = 0.0;
+        overdrawFrames = 0;
     }
 }
+
+void initGpuProfiler() {
+    if (gpuProfilePath.empty()) {
+        return;
+    }
+    gpuProfiler.Create();
+    renderGraph.SetProfiler(&gpuProfiler);
+}
+
+// the frame zone opens before the snow update, which runs on the GPU outside the render graph
+void beginGpuProfileFrame() {
+    if (gpuProfilePath.empty()) {
+        return;
+    }
+    gpuProfiler.BeginFrame();
+    gpuProfiler.Begin("frame");
+}
+
+void endGpuProfileFrame() {
+    if (gpuProfilePath.empty()) {
+        return;
+    }
+    gpuProfiler.End();
+    gpuProfiler.EndFrame();
+}
+
+void writeGpuProfile() {
+    if (gpuProfilePath.empty()) {
+        return;
+    }
+    if (!gpuProfiler.WriteReport(gpuProfilePath)) {
+        std::cerr << "Could not write GPU profile: " << gpuProfilePath << std::endl;
+    }
+}
+
+// the tour orbit, for a benchmark without --benchmark-path
+void createDefaultBenchmarkPath() {
+    const int KEY_COUNT = 8;
+    const float RADIUS = 30.0f;
+    std::vector<gps::CameraPathKey> keys;
+    for (int i = 0; i < KEY_COUNT; i++) {
+        float angle = glm::radians(360.0f * i / KEY_COUNT);
+        gps::CameraPathKey key = { glm::vec3(sin(angle) * RADIUS, 10.0f, cos(angle) * RADIUS), glm::vec3(0.0f, 2.0f, 0.0f) };
+        keys.push_back(key);
+    }
+    benchmarkPath.Create(keys, true, 10.0f);
+}
+
+// right before the main loop; the run ends by itself after the warm-up and the measured frames
+bool initBenchmark() {
+    if (!benchmarkEnabled) {
+        return true;
+    }
+    if (benchmarkPathFile.empty()) {
+        createDefaultBenchmarkPath();
+    }
+    else if (!benchmarkPath.Load(benchmarkPathFile)) {
+        return false;
+    }
+
+    // one fixed step per frame, so a frame always shows the same point of the path
+    int frames = benchmarkFrames;
+    if (frames == 0) {
+        frames = (int)ceil(benchmarkPath.GetLength() / benchmarkPath.GetSpeed() / SIMULATION_STEP);
+    }
+    frameCount = benchmarkWarmupFrames + frames;
+
+    glm::vec3 target;
+    benchmarkPath.Evaluate(0.0f, currentState.cameraPosition, target);
+    previousState = currentState;
+    renderState = currentState;
+
+    benchmark.SetParameter("renderer", (const char*)glGetString(GL_RENDERER));
+    benchmark.SetParameter("gl_version", (const char*)glGetString(GL_VERSION));
+    benchmark.SetParameter("resolution", std::to_string(myWindow.getWindowDimensions().width) + "x" + std::to_string(myWindow.getWindowDimensions().height));
+    benchmark.SetFlag("headless", headless);
+    benchmark.SetParameter("present_mode", gps::FramePacer::GetModeName(presentMode));
+    benchmark.SetParameter("shading", deferredShading ? "deferred" : "forward");
+    benchmark.SetFlag("depth_prepass", depthPrepassEnabled);
+    benchmark.SetParameter("pcf", pcfKernel);
+    benchmark.SetParameter("snow_particles", snowParticleCount);
+    benchmark.SetFlag("gpu_snow", gpuSnowEnabled);
+    benchmark.SetParameter("snow_resolution_scale", snowResolutionScale);
+    benchmark.SetParameter("camera_path", benchmarkPathFile.empty() ? "default" : benchmarkPathFile);
+    benchmark.SetParameter("camera_path_length", benchmarkPath.GetLength());
+    benchmark.SetParameter("camera_path_speed", benchmarkPath.GetSpeed());
+    benchmark.SetParameter("stress_objects", stressObjectCount);
+    benchmark.SetParameter("stress_lights", stressLightCount);
+    benchmark.SetParameter("stress_particles", stressParticleCount);
+    benchmark.SetParameter("stress_layout", stressLayout == gps::SCATTER_GRID ? "grid" : "poisson");
+    benchmark.SetParameter("stress_seed", (double)stressSeed);
+    benchmark.SetParameter("objects", (double)(staticObjects.size() + dynamicObjects.size()));
+    benchmark.SetParameter("particle_capacity", particleEngine.GetTotalCapacity());
+    benchmark.Create(benchmarkWarmupFrames, frames);
+
+    std::cout << "Benchmark: " << benchmarkWarmupFrames << " warm-up frames, then " << frames << " measured frames" << std::endl;
+    return true;
+}
+
+void writeBenchmarkReport() {
+    if (!benchmarkEnabled) {
+        return;
+    }
+    if (!benchmark.IsFinished()) {
+        std::cout << "Benchmark cancelled, no report written" << std::endl;
+        return;
+    }
+
+    gps::BenchmarkStats stats = benchmark.GetStats();
+    std::cout << "Benchmark: " << stats.average << " ms average, " << stats.p50 << "/" << stats.p95 << "/"
+        << stats.p99 << " ms p50/p95/p99, " << stats.max << " ms max, " << stats.fps << " FPS" << std::endl;
+    if (!benchmark.WriteReport(benchmarkReportPath)) {
+        std::cerr << "Could not write benchmark report: " << benchmarkReportPath << std::endl;
+    }
+}
+
+void initLatencyQueries() {
+    glGenQueries(LATENCY_QUERY_COUNT, latencyQueries);
+    for (int i = 0; i < LATENCY_QUERY_COUNT; i++) {
+        latencyQueryPending[i] = false;
+    }
+}
+
+// lines the GPU clock up with glfwGetTime(); redone with every report, the clocks drift apart
+void calibrateGpuClock() {
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    gpuClockOffset = glfwGetTime() - gpuTime * 1e-9;
+}
+
+void collectLatencyQuery(int index) {
+    if (!latencyQueryPending[index]) {
+        return;
+    }
+
+    GLuint available = 0;
+    glGetQueryObjectuiv(latencyQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return;
+    }
+
+    GLuint64 gpuTime = 0;
+    glGetQueryObjectui64v(latencyQueries[index], GL_QUERY_RESULT, &gpuTime);
+    latencyQueryPending[index] = false;
+
+    double finished = gpuTime * 1e-9 + gpuClockOffset;
+    latencySum += latencyInputCount[index] * finished - latencyInputTimeSum[index];
+    latencyMax = std::max(latencyMax, finished - latencyInputOldest[index]);
+    latencyEvents += latencyInputCount[index];
+}
+
+// timestamps the end of the frame on the GPU if it applied any mouse movement
+void issueLatencyQuery() {
+    collectLatencyQuery(latencyQueryIndex);
+    if (frameInputCount > 0 && !latencyQueryPending[latencyQueryIndex]) {
+        glQueryCounter(latencyQueries[latencyQueryIndex], GL_TIMESTAMP);
+        latencyQueryPending[latencyQueryIndex] = true;
+        latencyInputCount[latencyQueryIndex] = frameInputCount;
+        latencyInputTimeSum[latencyQueryIndex] = frameInputTimeSum;
+        latencyInputOldest[latencyQueryIndex] = frameInputOldest;
+    }
+    latencyQueryIndex = (latencyQueryIndex + 1) % LATENCY_QUERY_COUNT;
+
+    frameInputCount = 0;
+    frameInputTimeSum = 0.0;
+}
+
+// after the swap: limiter wait, then a timing report every FRAME_PACING_REPORT_FRAMES frames
+void endFrame() {
+    issueLatencyQuery();
+    framePacer.EndFrame();
+    if (benchmarkEnabled) {
+        benchmark.EndFrame();
+    }
+
+    gps::FramePacingStats stats = framePacer.GetStats();
+    if (stats.frames == FRAME_PACING_REPORT_FRAMES) {
+        std::cout << "Frame pacing (" << gps::FramePacer::GetModeName(framePacer.GetMode()) << "): "
+            << stats.average << " ms average, " << stats.min << "/" << stats.max << " ms min/max, "
+            << stats.p99 << " ms p99, " << stats.jitter << " ms jitter" << std::endl;
+        if (latencyEvents > 0) {
+            std::cout << "Input latency (to GPU completion): " << latencySum / latencyEvents * 1000.0 << " ms average, "
+                << latencyMax * 1000.0 << " ms max over " << latencyEvents << " mouse events" << std::endl;
+        }
+        framePacer.ResetStats();
+        writeGpuProfile();
+        latencySum = 0.0;
+        latencyMax = 0.0;
+        latencyEvents = 0;
+        calibrateGpuClock();
+    }
+}
+
+void renderDepthPrepass() {
+    depthPrepassShader.useShaderProgram();
+    glUniformMatrix4fv(glGetUniformLocation(depthPrepassShader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(depthPrepassShader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+
+    renderAllObjects(depthPrepassShader);
+}
+
+void beginMainPass() {
+    collectOverdrawQuery(overdrawQueryIndex);
+    if (!overdrawQueryPending[overdrawQueryIndex]) {
+        glBeginQuery(GL_SAMPLES_PASSED, overdrawQueries[overdrawQueryIndex]);
+    }
+}
+
+void endMainPass() {
+    if (!overdrawQueryPending[overdrawQueryIndex]) {
+        glEndQuery(GL_SAMPLES_PASSED);
+        overdrawQueryPending[overdrawQueryIndex] = true;
+    }
+    overdrawQueryIndex = (overdrawQueryIndex + 1) % OVERDRAW_QUERY_COUNT;
+}
+
+// with the pre-pass the depth buffer is already final, only the exact front-most fragment passes
+gps::RenderPassState mainPassState() {
+    gps::RenderPassState state;
+    if (depthPrepassEnabled) {
+        state.depthFunc = GL_EQUAL;
+        state.depthWrite = false;
+    }
+    else {
+        state.clearDepth = true;
+    }
+    return state;
+}
+
+void addDepthPrepass(gps::RenderResource depthTarget) {
+    renderGraph.AddPass("depthPrepass",
+        [=](gps::RenderPassBuilder& builder) {
+            builder.Write(depthTarget);
+            gps::RenderPassState state;
+            state.colorWrite = false;
+            state.clearColor = true;
+            state.clearDepth = true;
+            builder.SetState(state);
+        },
+        [](gps::RenderPassContext& context) {
+            renderDepthPrepass();
+        });
+}
+
+void addForwardPasses(gps::RenderResource backbuffer, gps::RenderResource shadowMap) {
+    if (depthPrepassEnabled) {
+        addDepthPrepass(backbuffer);
+    }
+
+    renderGraph.AddPass("forward",
+        [=](gps::RenderPassBuilder& builder) {
+            if (sunLightEnabled) {
+                builder.Read(shadowMap);
+            }
+            builder.Write(backbuffer);
+            gps::RenderPassState state = mainPassState();
+            state.clearColor = !depthPrepassEnabled;
+            builder.SetState(state);
+        },
+        [=](gps::RenderPassContext& context) {
+            myBasicShader.useShaderProgram();
+            setShadowUniforms(myBasicShader, context, shadowMap);
+
+            float aspect = (float)context.GetWidth() / (float)context.GetHeight();
+            lightClusterer.Update(pointLights, view, glm::radians(CAMERA_FOV), aspect, CAMERA_NEAR, CAMERA_FAR);
+            lightClusterer.Bind(myBasicShader, context.AllocateTextureUnits(3), context.GetWidth(), context.GetHeight());
+
+            beginMainPass();
+            renderAllObjects(myBasicShader);
+            endMainPass();
+        });
+}
+
+// returns the G-buffer depth, for later passes that need the scene depth as a texture
+gps::RenderResource addDeferredPasses(gps::RenderResource backbuffer, gps::RenderResource shadowMap, int width, int height) {
+    gps::GBufferTargets gBuffer = deferredRenderer.DeclareGBuffer(renderGraph, width, height);
+
+    if (depthPrepassEnabled) {
+        addDepthPrepass(gBuffer.depth);
+    }
+
+    // geometry pass - the same draws as the forward path, but only material data is written
+    renderGraph.AddPass("gBuffer",
+        [=](gps::RenderPassBuilder& builder) {
+            builder.Write(gBuffer.normal);
+            builder.Write(gBuffer.albedo);
+            builder.Write(gBuffer.specular);
+            builder.Write(gBuffer.depth);
+            gps::RenderPassState state = mainPassState();
+            state.clearColor = true;
+            builder.SetState(state);
+        },
+        [](gps::RenderPassContext& context) {
+            gBufferShader.useShaderProgram();
+            glUniformMatrix4fv(glGetUniformLocation(gBufferShader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(glGetUniformLocation(gBufferShader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+            beginMainPass();
+            renderAllObjects(gBufferShader);
+            endMainPass();
+        });
+
+    // directional light with shadows and fog, once per pixel; also copies the G-buffer depth
+    renderGraph.AddPass("deferredSun",
+        [=](gps::RenderPassBuilder& builder) {
+            builder.Read(gBuffer.normal);
+            builder.Read(gBuffer.albedo);
+            builder.Read(gBuffer.specular);
+            builder.Read(gBuffer.depth);
+            if (sunLightEnabled) {
+                builder.Read(shadowMap);
+            }
+            builder.Write(backbuffer);
+            gps::RenderPassState state;
+            state.depthFunc = GL_ALWAYS;
+            state.clearColor = true;
+            state.clearDepth = true;
+            builder.SetState(state);
+        },
+        [=](gps::RenderPassContext& context) {
+            // the lighting passes are screen-space, wireframe/point mode only applies to the geometry
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+            deferredRenderer.BindGBuffer(deferredDirectionalShader, context, gBuffer);
+            setShadowUniforms(deferredDirectionalShader, context, shadowMap);
+            GLuint program = deferredDirectionalShader.shaderProgram;
+            glUniformMatrix4fv(glGetUniformLocation(program, "inverseProjection"), 1, GL_FALSE, glm::value_ptr(glm::inverse(projection)));
+            glUniformMatrix4fv(glGetUniformLocation(program, "inverseView"), 1, GL_FALSE, glm::value_ptr(glm::inverse(view)));
+            glUniform3fv(glGetUniformLocation(program, "lightDir"), 1, glm::value_ptr(lightDir));
+            glUniform3fv(glGetUniformLocation(program, "lightColor"), 1, glm::value_ptr(lightColor));
+            glUniform1i(glGetUniformLocation(program, "sunEnabled"), sunLightEnabled);
+            glUniform1i(glGetUniformLocation(program, "enableFog"), fogEnabled);
+
+            deferredRenderer.DrawFullscreenTriangle();
+        });
+
+    // point lights as additive light volumes - back faces behind the surface touch the lit pixels,
+    // which also works with the camera inside the volume
+    renderGraph.AddPass("deferredPointLights",
+        [=](gps::RenderPassBuilder& builder) {
+            builder.Read(gBuffer.normal);
+            builder.Read(gBuffer.albedo);
+            builder.Read(gBuffer.specular);
+            builder.Read(gBuffer.depth);
+            builder.Write(backbuffer);
+            gps::RenderPassState state;
+            state.blend = true;
+            state.blendSrc = GL_ONE;
+            state.blendDst = GL_ONE;
+            state.depthWrite = false;
+            state.depthFunc = GL_GEQUAL;
+            state.cullMode = GL_FRONT;
+            builder.SetState(state);
+        },
+        [=](gps::RenderPassContext& context) {
+            deferredRenderer.BindGBuffer(deferredPointLightShader, context, gBuffer);
+            GLuint program = deferredPointLightShader.shaderProgram;
+            glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+            glUniformMatrix4fv(glGetUniformLocation(program, "inverseProjection"), 1, GL_FALSE, glm::value_ptr(glm::inverse(projection)));
+            glUniform1i(glGetUniformLocation(program, "enableFog"), fogEnabled);
+
+            // looked up once, the loop runs for every light of the stress scene
+            GLint lightPositionWorldLoc = glGetUniformLocation(program, "lightPositionWorld");
+            GLint lightPositionLoc = glGetUniformLocation(program, "lightPosition");
+            GLint lightColorLoc = glGetUniformLocation(program, "lightColor");
+            GLint lightRadiusLoc = glGetUniformLocation(program, "lightRadius");
+
+            glEnable(GL_DEPTH_CLAMP);
+            for (size_t i = 0; i < pointLights.size(); i++) {
+                const gps::PointLight& light = pointLights[i];
+                glm::vec3 positionEye = glm::vec3(view * glm::vec4(light.position, 1.0f));
+                glUniform3fv(lightPositionWorldLoc, 1, glm::value_ptr(light.position));
+                glUniform3fv(lightPositionLoc, 1, glm::value_ptr(positionEye));
+                glUniform3fv(lightColorLoc, 1, glm::value_ptr(light.color));
+                glUniform1f(lightRadiusLoc, light.radius);
+                deferredRenderer.DrawLightVolume();
+            }
+            glDisable(GL_DEPTH_CLAMP);
+
+            restoreRenderMode();
+        });
+
+    return gBuffer.depth;
+}
+
+// sceneDepth is the full resolution depth texture of the frame, or -1 when the scene only
+// rendered into the backbuffer (forward path)
+void addSnowPasses(gps::RenderResource backbuffer, gps::RenderResource sceneDepth, int width, int height) {
+    gps::RenderPassState snowState;
+    snowState.blend = true;
+    snowState.blendSrc = GL_ONE;
+    snowState.depthWrite = false;
+
+    if (snowResolutionScale == 1) {
+        renderGraph.AddPass("snow",
+            [=](gps::RenderPassBuilder& builder) {
+                builder.Write(backbuffer);
+                builder.SetState(snowState);
+            },
+            [=](gps::RenderPassContext& context) {
+                renderSnow(height);
+            });
+        return;
+    }
+
+    // the multisampled default framebuffer cannot be sampled, so the forward path
+    // lays down the depth once more, into a texture
+    if (sceneDepth < 0) {
+        gps::RenderTargetDesc depthDesc = { width, height, GL_DEPTH_COMPONENT24 };
+        sceneDepth = renderGraph.CreateTexture("sceneDepth", depthDesc);
+
+        renderGraph.AddPass("sceneDepth",
+            [=](gps::RenderPassBuilder& builder) {
+                builder.Write(sceneDepth);
+                gps::RenderPassState state;
+                state.colorWrite = false;
+                state.clearDepth = true;
+                builder.SetState(state);
+            },
+            [](gps::RenderPassContext& context) {
+                renderDepthPrepass();
+            });
+    }
+
+    int snowWidth = std::max(width / snowResolutionScale, 1);
+    int snowHeight = std::max(height / snowResolutionScale, 1);
+    gps::RenderTargetDesc colorDesc = { snowWidth, snowHeight, GL_RGBA8 };
+    gps::RenderTargetDesc depthDesc = { snowWidth, snowHeight, GL_DEPTH_COMPONENT24 };
+    gps::RenderResource snowColor = renderGraph.CreateTexture("snowColor", colorDesc);
+    gps::RenderResource snowDepth = renderGraph.CreateTexture("snowDepth", depthDesc);
+
+    renderGraph.AddPass("snowDepthDownsample",
+        [=](gps::RenderPassBuilder& builder) {
+            builder.Read(sceneDepth);
+            builder.Write(snowDepth);
+            gps::RenderPassState state;
+            state.depthFunc = GL_ALWAYS;
+            state.colorWrite = false;
+            builder.SetState(state);
+        },
+        [=](gps::RenderPassContext& context) {
+            snowDepthDownsampleShader.useShaderProgram();
+            context.BindTexture(snowDepthDownsampleShader, "sceneDepth", sceneDepth);
+            glUniform1i(glGetUniformLocation(snowDepthDownsampleShader.shaderProgram, "scale"), snowResolutionScale);
+            // screen-space like the lighting passes, wireframe/point mode only applies to the geometry
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            deferredRenderer.DrawFullscreenTriangle();
+            restoreRenderMode();
+        });
+
+    renderGraph.AddPass("snowLowResolution",
+        [=](gps::RenderPassBuilder& builder) {
+            builder.Write(snowColor);
+            builder.Write(snowDepth);
+            builder.SetState(snowState);
+        },
+        [=](gps::RenderPassContext& context) {
+            // transparent black, the composite adds the flakes over the scene
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+            renderSnow(height);
+        });
+
+    renderGraph.AddPass("snowComposite",
+        [=](gps::RenderPassBuilder& builder) {
+            builder.Read(snowColor);
+            builder.Read(snowDepth);
+            builder.Read(sceneDepth);
+            builder.Write(backbuffer);
+            gps::RenderPassState state = snowState;
+            state.depthTest = false;
+            builder.SetState(state);
+        },
+        [=](gps::RenderPassContext& context) {
+            GLuint program = snowCompositeShader.shaderProgram;
+            snowCompositeShader.useShaderProgram();
+            context.BindTexture(snowCompositeShader, "snowColor", snowColor);
+            context.BindTexture(snowCompositeShader, "snowDepth", snowDepth);
+            context.BindTexture(snowCompositeShader, "sceneDepth", sceneDepth);
+            glUniform1i(glGetUniformLocation(program, "scale"), snowResolutionScale);
+            glUniform1f(glGetUniformLocation(program, "cameraNear"), CAMERA_NEAR);
+            glUniform1f(glGetUniformLocation(program, "cameraFar"), CAMERA_FAR);
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            deferredRenderer.DrawFullscreenTriangle();
+            restoreRenderMode();
+        });
+}
+
+// The frame is described as a render graph: every pass declares what it reads and writes,
+// the graph drops the passes nobody consumes (the shadow cascades while the sun is off),
+// allocates the transient targets and sets framebuffer, viewport and fixed function state.
+void renderScene() {
+    PROFILE_ZONE("renderScene");
+    int width = myWindow.getWindowDimensions().width;
+    int height = myWindow.getWindowDimensions().height;
+
+    updatePointLights();
+    prepareFrame();
+
+    renderGraph.Reset();
+    gps::RenderResource backbuffer = renderGraph.ImportFramebuffer("backbuffer", backbufferFramebuffer, width, height);
+    gps::RenderResource shadowMap = renderGraph.ImportTexture("shadowCascades", shadowCascades.GetDepthTexture(),
+        GL_TEXTURE_2D_ARRAY, shadowCascades.GetResolution(), shadowCascades.GetResolution());
+    renderGraph.MarkOutput(backbuffer);
+
+    renderGraph.AddPass("shadows",
+        [=](gps::RenderPassBuilder& builder) {
+            builder.Write(shadowMap);
+            // one framebuffer per cascade, bound by CascadedShadowMap
+            builder.SetManualTargets();
+            gps::RenderPassState state;
+            state.cullMode = GL_FRONT;
+            builder.SetState(state);
+        },
+        [](gps::RenderPassContext& context) {
+            renderShadowMap();
+        });
+
+    gps::RenderResource sceneDepth = -1;
+    if (deferredShading) {
+        sceneDepth = addDeferredPasses(backbuffer, shadowMap, width, height);
+    }
+    else {
+        addForwardPasses(backbuffer, shadowMap);
+    }
+
+    renderGraph.AddPass("skybox",
+        [=](gps::RenderPassBuilder& builder) {
+            builder.Write(backbuffer);
+        },
+        [](gps::RenderPassContext& context) {
+            if (sunLightEnabled) {
+                mySkyBox.Draw(skyboxShader, view, projection);
+            }
+            else {
+                myNightSkyBox.Draw(skyboxShader, view, projection);
+            }
+        });
+
+    if (particlesUploaded) {
+        renderGraph.AddPass("particles",
+            [=](gps::RenderPassBuilder& builder) {
+                builder.Write(backbuffer);
+                gps::RenderPassState state;
+                state.blend = true;
+                state.blendSrc = GL_ONE;
+                state.depthWrite = false;
+                builder.SetState(state);
+            },
+            [](gps::RenderPassContext& context) {
+                renderParticles();
+            });
+    }
+
+    if (snowEnabled && (gpuSnowEnabled || snowUploaded)) {
+        addSnowPasses(backbuffer, sceneDepth, width, height);
+    }
+
+    {
+        PROFILE_ZONE("renderGraph.Compile");
+        renderGraph.Compile();
+    }
+
+    std::string layout = renderGraph.Describe();
+    if (layout != renderGraphLayout) {
+        std::cout << "Render graph: " << layout << std::endl;
+        renderGraphLayout = layout;
+    }
+
+    {
+        PROFILE_ZONE("renderGraph.Execute");
+        renderGraph.Execute();
+    }
+}
+
+void parseArguments(int argc, const char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--pcf" && i + 1 < argc) {
+            pcfKernel = argv[++i];
+        }
+        else if (arg == "--deferred") {
+            deferredShading = true;
+        }
+        else if (arg == "--gpu-snow") {
+            gpuSnowEnabled = true;
+        }
+        else if (arg == "--snow-particles" && i + 1 < argc) {
+            snowParticleCount = std::max(atoi(argv[++i]), 1);
+        }
+        else if (arg == "--snow-resolution" && i + 1 < argc) {
+            std::string resolution = argv[++i];
+            snowResolutionScale = resolution == "quarter" ? 4 : (resolution == "half" ? 2 : 1);
+            if (resolution != "full" && snowResolutionScale == 1) {
+                std::cout << "Unknown snow resolution '" << resolution << "', using full resolution" << std::endl;
+            }
+        }
+        else if (arg == "--present" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            for (int m = 0; m < gps::PRESENT_MODE_COUNT; m++) {
+                if (mode == gps::FramePacer::GetModeName((gps::PresentMode)m)) {
+                    presentMode = (gps::PresentMode)m;
+                    presentModeSet = true;
+                }
+            }
+        }
+        else if (arg == "--fps-limit" && i + 1 < argc) {
+            frameLimit = std::max(atof(argv[++i]), 1.0);
+            presentMode = gps::PRESENT_LIMITED;
+            presentModeSet = true;
+        }
+        else if (arg == "--gpu-profile" && i + 1 < argc) {
+            gpuProfilePath = argv[++i];
+        }
+        else if (arg == "--cpu-trace" && i + 1 < argc) {
+            cpuTracePath = argv[++i];
+            cpuTraceAtStartup = true;
+        }
+        else if (arg == "--cpu-trace-frames" && i + 1 < argc) {
+            cpuTraceFrames = std::max(atoi(argv[++i]), 1);
+        }
+        else if (arg == "--headless") {
+            headless = true;
+        }
+        else if (arg == "--resolution" && i + 1 < argc) {
+            int width = 0, height = 0;
+            if (sscanf(argv[++i], "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+                windowWidth = width;
+                windowHeight = height;
+            }
+        }
+        else if (arg == "--frames" && i + 1 < argc) {
+            frameCount = std::max(atoi(argv[++i]), 0);
+        }
+        else if (arg == "--screenshot" && i + 1 < argc) {
+            screenshotPath = argv[++i];
+        }
+        else if (arg == "--benchmark" && i + 1 < argc) {
+            benchmarkReportPath = argv[++i];
+            benchmarkEnabled = true;
+        }
+        else if (arg == "--benchmark-path" && i + 1 < argc) {
+            benchmarkPathFile = argv[++i];
+        }
+        else if (arg == "--benchmark-warmup" && i + 1 < argc) {
+            benchmarkWarmupFrames = std::max(atoi(argv[++i]), 0);
+        }
+        else if (arg == "--benchmark-frames" && i + 1 < argc) {
+            benchmarkFrames = std::max(atoi(argv[++i]), 0);
+        }
+        else if (arg == "--stress-objects" && i + 1 < argc) {
+            stressObjectCount = std::max(atoi(argv[++i]), 0);
+        }
+        else if (arg == "--stress-lights" && i + 1 < argc) {
+            stressLightCount = std::max(atoi(argv[++i]), 0);
+        }
+        else if (arg == "--stress-particles" && i + 1 < argc) {
+            stressParticleCount = std::max(atoi(argv[++i]), 0);
+        }
+        else if (arg == "--stress-layout" && i + 1 < argc) {
+            std::string layout = argv[++i];
+            stressLayout = layout == "grid" ? gps::SCATTER_GRID : gps::SCATTER_POISSON;
+        }
+        else if (arg == "--stress-seed" && i + 1 < argc) {
+            stressSeed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (arg == "--snow-benchmark") {
+            snowBenchmark = true;
+        }
+        else {
+            std::cout << "Unknown argument: " << arg << std::endl;
+        }
+    }
+
+    // nobody watches a headless run: one frame unless asked for more, and no vsync
+    if (headless) {
+        if (frameCount == 0) {
+            frameCount = 1;
+        }
+        if (!presentModeSet) {
+            presentMode = gps::PRESENT_UNCAPPED;
+        }
+    }
+
+    // the same toggles for every run, and no vsync capping the frame times
+    if (benchmarkEnabled) {
+        fogEnabled = true;
+        snowEnabled = true;
+        lanternLightEnabled = true;
+        campfireLightEnabled = true;
+        sunLightEnabled = true;
+        if (!presentModeSet) {
+            presentMode = gps::PRESENT_UNCAPPED;
+        }
+    }
+}
+
+// particles/second of the CPU snow update, on one thread and on the job system;
+// the output goes to plain memory, so no GL context is needed
+void runSnowBenchmark() {
+    const int WARMUP_FRAMES = 20;
+    const int FRAMES = 200;
+    const float DELTA_TIME = 1.0f / 60.0f;
+
+    jobSystem.Create();
+    std::vector<glm::vec4> upload(snowParticleCount);
+    glm::vec3 volumeMin = getSnowVolumeMin(glm::vec3(0.0f));
+
+    for (int threaded = 0; threaded < 2; threaded++) {
+        gps::SnowSimulation simulation;
+        simulation.Create(snowParticleCount, volumeMin, SNOW_VOLUME_SIZE);
+        gps::JobSystem* jobs = threaded ? &jobSystem : NULL;
+
+        for (int i = 0; i < WARMUP_FRAMES; i++) {
+            simulation.Update(jobs, DELTA_TIME, volumeMin, SNOW_VOLUME_SIZE, NULL, upload.data());
+        }
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < FRAMES; i++) {
+            simulation.Update(jobs, DELTA_TIME, volumeMin, SNOW_VOLUME_SIZE, NULL, upload.data());
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+        std::cout << "Snow benchmark (" << (threaded ? jobSystem.GetThreadCount() : 1) << " threads): "
+            << snowParticleCount << " particles, " << seconds * 1000.0 / FRAMES << " ms/update, "
+            << (double)snowParticleCount * FRAMES / seconds / 1e6 << " M particles/s" << std::endl;
+    }
+
+    jobSystem.Delete();
+}
+
 void cleanup() {
+    shadowCascades.Delete();
+    lightClusterer.Delete();
+    glDeleteQueries(OVERDRAW_QUERY_COUNT, overdrawQueries);
+    glDeleteQueries(LATENCY_QUERY_COUNT, latencyQueries);
+    writeGpuProfile();
+    gpuProfiler.Delete();
+    if (headless) {
+        glDeleteFramebuffers(1, &headlessFramebuffer);
+        glDeleteRenderbuffers(1, &headlessColorBuffer);
+        glDeleteRenderbuffers(1, &headlessDepthBuffer);
+    }
+    renderGraph.Delete();
+    jobSystem.Delete();
+    frameStream.Delete();
+    surfaceHeightfield.Delete();
+    if (gpuSnowEnabled) {
+        gpuSnow.Delete();
+    }
+    if (deferredShading || snowResolutionScale > 1) {
+        deferredRenderer.Delete();
+    }
     myWindow.Delete();
 }
 
 int main(int argc, const char* argv[]) {
+    parseArguments(argc, argv);
+
+    if (snowBenchmark) {
+        runSnowBenchmark();
+        return EXIT_SUCCESS;
+    }
+
     try {
         initOpenGLWindow();
     }
@@ -571,11 +2370,21 @@ int main(int argc, const char* argv[]) {
     }
 
     initOpenGLState();
+    initHeadlessFramebuffer();
+    framePacer.Create(presentMode, frameLimit);
+    jobSystem.Create();
     initModels();
+    initSceneObjects();
     initShaders();
     initUniforms();
     initSkybox();
     initFBO();
+    initParticleSystems();
+    initStreamBuffer();
+    initOverdrawQueries();
+    initLatencyQueries();
+    calibrateGpuClock();
+    initGpuProfiler();
     setWindowCallbacks();
 
     glfwSetInputMode(myWindow.getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -591,25 +2400,78 @@ int main(int argc, const char* argv[]) {
     std::cout << "N - Ninsoare ON/OFF\n";
     std::cout << "L - Lanterna ON/OFF\n";
     std::cout << "C - Campfire ON/OFF\n";
+    std::cout << "Z - Depth pre-pass ON/OFF\n";
+    std::cout << "T - Captura profil CPU (Chrome trace)\n";
+    std::cout << "V - Mod prezentare (vsync/adaptive/uncapped/limited)\n";
     std::cout << "1/2/3 - Mod randare (Solid/Wireframe/Point)\n";
     std::cout << "ESC - Iesire\n";
     std::cout << "==================\n\n";
-    float lastFrame = 0.0f;
+    initSimulation();
+    if (!initBenchmark()) {
+        cleanup();
+        return EXIT_FAILURE;
+    }
+    double lastFrame = glfwGetTime();
+    PROFILE_THREAD("main");
+    if (cpuTraceAtStartup) {
+        startCpuTrace();
+    }
 
+    int framesRendered = 0;
     while (!glfwWindowShouldClose(myWindow.getWindow())) {
-        float currentFrame = glfwGetTime();
-        float deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        updateSnowParticles(deltaTime);
-        processMovement();
-        renderScene();
-        renderSnow();
-        glfwPollEvents();
-        glfwSwapBuffers(myWindow.getWindow());
-        glCheckError();
+        {
+            PROFILE_ZONE("frame");
+            double currentFrame = glfwGetTime();
+            float deltaTime = (float)(currentFrame - lastFrame);
+            lastFrame = currentFrame;
+            // a benchmark frame is exactly one step, however long it took
+            if (benchmarkEnabled) {
+                deltaTime = (float)SIMULATION_STEP;
+            }
+
+            {
+                // blocks only if the GPU is still reading the section written FRAME_COUNT frames ago
+                PROFILE_ZONE("frameStream.BeginFrame");
+                frameStream.BeginFrame();
+            }
+            // input is read after the possible wait above, and again right before the frame is built
+            glfwPollEvents();
+            processInput();
+            beginGpuProfileFrame();
+            updateSnowParticles(deltaTime);
+            updateParticleSystems(deltaTime);
+            advanceSimulation(deltaTime);
+            latchCameraOrientation();
+            writeParticleInstances();
+            renderScene();
+            endGpuProfileFrame();
+            frameStream.EndFrame();
+
+            framesRendered++;
+            bool finalFrame = frameCount > 0 && framesRendered >= frameCount;
+            if (finalFrame) {
+                if (!screenshotPath.empty()) {
+                    saveScreenshot(screenshotPath);
+                }
+                glfwSetWindowShouldClose(myWindow.getWindow(), GL_TRUE);
+            }
+            {
+                PROFILE_ZONE("glfwSwapBuffers");
+                glfwSwapBuffers(myWindow.getWindow());
+            }
+            {
+                PROFILE_ZONE("endFrame");
+                endFrame();
+            }
+            {
+                PROFILE_ZONE("glCheckError");
+                glCheckError();
+            }
+        }
+        gps::CpuProfiler::EndFrame();
     }
 
+    writeBenchmarkReport();
     cleanup();
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -3,7 +3,7 @@
 in vec3 fPosition;
 in vec3 fNormal;
 in vec2 fTexCoords;
-in vec4 fragPosLightSpace;
+in vec3 fPositionWorld;
 
 out vec4 fColor;
 
@@ -12,18 +12,26 @@ uniform vec3 lightDir; // Soare
 uniform vec3 lightColor;
 uniform bool sunEnabled; // Buton ON/OFF soare
 
-// Point Light 1 (Lanterna)
-uniform vec3 pointLightPos;
-uniform vec3 pointLightColor;
-
-// Point Light 2 (Campfire)
-uniform vec3 campfirePos;
-uniform vec3 campfireColor;
+// --- Point lights (clustered forward) ---
+// 2 texeli per lumina: (pozitie in eye space, raza), (culoare, 0)
+uniform samplerBuffer lightData;
+// (offset, numar de lumini) pentru fiecare cluster
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+uniform ivec3 clusterDims;
+uniform vec2 clusterTileScale;   // clustere pe pixel, pe x si y
+uniform vec2 clusterDepthParams; // slice = log(depth) * x + y
 
 // --- Textures ---
 uniform sampler2D diffuseTexture;
 uniform sampler2D specularTexture;
-uniform sampler2D shadowMap;
+uniform sampler2DArrayShadow shadowMap;
+
+// --- Shadow cascades ---
+const int MAX_CASCADES = 4;
+uniform mat4 lightSpaceTrMatrices[MAX_CASCADES];
+uniform float cascadeSplits[MAX_CASCADES]; // distanta (view space) la care se termina fiecare cascada
+uniform int cascadeCount;
 
 // --- Material ---
 float ambientStrength = 0.2;
@@ -53,11 +61,14 @@ vec3 computeDirLight(vec3 normalEye, vec3 viewDir, vec3 diffTex, vec3 specTex, f
     return ambient + (1.0 - shadow) * (diffuse + specular);
 }
 
-vec3 computeCustomPointLight(vec3 lightPos, vec3 lightColor, vec3 normalEye, vec3 viewDir, vec3 diffTex, vec3 specTex)
+vec3 computeCustomPointLight(vec3 lightPos, vec3 lightColor, float radius, vec3 normalEye, vec3 viewDir, vec3 diffTex, vec3 specTex)
 {
     vec3 lightDir = normalize(lightPos - fPosition);
     float distance = length(lightPos - fPosition);
     float attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));
+    // stinge lumina lin spre raza ei, ca sa nu se vada marginile clusterelor
+    float window = clamp(1.0 - pow(distance / radius, 4.0), 0.0, 1.0);
+    attenuation *= window * window;
 
     float diff = max(dot(normalEye, lightDir), 0.0);
     vec3 reflectDir = reflect(-lightDir, normalEye);
@@ -70,6 +81,23 @@ vec3 computeCustomPointLight(vec3 lightPos, vec3 lightColor, vec3 normalEye, vec
     return (ambient + diffuse + specular) * attenuation;
 }
 
+vec3 computeClusteredPointLights(vec3 normalEye, vec3 viewDir, vec3 diffTex, vec3 specTex)
+{
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy * clusterTileScale), ivec2(0), clusterDims.xy - 1);
+    int slice = clamp(int(log(-fPosition.z) * clusterDepthParams.x + clusterDepthParams.y), 0, clusterDims.z - 1);
+    int cluster = tile.x + clusterDims.x * (tile.y + clusterDims.y * slice);
+
+    uvec2 range = texelFetch(clusterGrid, cluster).xy;
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < range.y; ++i) {
+        int lightIndex = int(texelFetch(clusterIndices, int(range.x + i)).r);
+        vec4 positionRadius = texelFetch(lightData, 2 * lightIndex);
+        vec3 color = texelFetch(lightData, 2 * lightIndex + 1).rgb;
+        result += computeCustomPointLight(positionRadius.xyz, color, positionRadius.w, normalEye, viewDir, diffTex, specTex);
+    }
+    return result;
+}
+
 float computeFog()
 {
     float fogDensity = 0.03;
@@ -78,27 +106,84 @@ float computeFog()
     return clamp(fogFactor, 0.0, 1.0);
 }
 
+int selectCascade()
+{
+    float depth = -fPosition.z;
+    for (int i = 0; i < cascadeCount - 1; ++i) {
+        if (depth < cascadeSplits[i]) return i;
+    }
+    return cascadeCount - 1;
+}
+
+// Kernel PCF ales la compilare (vezi initShaders): PCF_TAPS 1/4/9/16 sau PCF_POISSON.
+// Fiecare fetch prin sampler2DArrayShadow face deja o comparatie filtrata biliniar pe 2x2 texeli.
+#if !defined(PCF_TAPS) && !defined(PCF_POISSON)
+#define PCF_TAPS 4
+#endif
+
+#ifdef PCF_POISSON
+const int POISSON_TAPS = 12;
+const vec2 poissonDisk[POISSON_TAPS] = vec2[](
+    vec2(-0.326, -0.406), vec2(-0.840, -0.074), vec2(-0.696,  0.457),
+    vec2(-0.203,  0.621), vec2( 0.962, -0.195), vec2( 0.473, -0.480),
+    vec2( 0.519,  0.767), vec2( 0.185, -0.893), vec2( 0.507,  0.064),
+    vec2( 0.896,  0.412), vec2(-0.322, -0.933), vec2(-0.792, -0.598)
+);
+#endif
+
+float sampleShadow(vec2 uv, float layer, float depth)
+{
+    // 1.0 = lit, 0.0 = in shadow
+    return texture(shadowMap, vec4(uv, layer, depth));
+}
+
 float computeShadow()
 {
+    int cascade = selectCascade();
+    vec4 fragPosLightSpace = lightSpaceTrMatrices[cascade] * vec4(fPositionWorld, 1.0);
     vec3 normalizedCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     normalizedCoords = normalizedCoords * 0.5 + 0.5;
     if (normalizedCoords.z > 1.0) return 0.0;
 
-    float currentDepth = normalizedCoords.z;
     vec3 normal = normalize(fNormal);
     vec3 lightDirN = normalize(lightDir);
     float bias = max(0.005 * (1.0 - dot(normal, lightDirN)), 0.0005);
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-
-    for(int x = -1; x <= 1; ++x) {
-        for(int y = -1; y <= 1; ++y) {
-            float pcfDepth = texture(shadowMap, normalizedCoords.xy + vec2(x, y) * texelSize).r; 
-            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;        
-        }    
+    float currentDepth = normalizedCoords.z - bias;
+    float layer = float(cascade);
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+
+#if defined(PCF_POISSON)
+    for (int i = 0; i < POISSON_TAPS; ++i) {
+        lit += sampleShadow(normalizedCoords.xy + poissonDisk[i] * 1.5 * texelSize, layer, currentDepth);
+    }
+    lit /= float(POISSON_TAPS);
+#elif PCF_TAPS == 1
+    lit = sampleShadow(normalizedCoords.xy, layer, currentDepth);
+#elif PCF_TAPS == 4
+    for (int x = 0; x < 2; ++x) {
+        for (int y = 0; y < 2; ++y) {
+            lit += sampleShadow(normalizedCoords.xy + (vec2(x, y) - 0.5) * texelSize, layer, currentDepth);
+        }
     }
-    shadow /= 9.0;
-    return shadow;
+    lit /= 4.0;
+#elif PCF_TAPS == 9
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            lit += sampleShadow(normalizedCoords.xy + vec2(x, y) * texelSize, layer, currentDepth);
+        }
+    }
+    lit /= 9.0;
+#else
+    for (int x = 0; x < 4; ++x) {
+        for (int y = 0; y < 4; ++y) {
+            lit += sampleShadow(normalizedCoords.xy + (vec2(x, y) - 1.5) * texelSize, layer, currentDepth);
+        }
+    }
+    lit /= 16.0;
+#endif
+
+    return 1.0 - lit;
 }
 
 void main()
@@ -108,18 +193,16 @@ void main()
     vec3 texDiffuse = texture(diffuseTexture, fTexCoords).rgb;
     vec3 texSpecular = texture(specularTexture, fTexCoords).rgb;
 
-    float shadow = computeShadow();
+    // fara soare harta de umbre nu e legata, nu o citim
+    float shadow = sunEnabled ? computeShadow() : 0.0;
 
     // Lumina Soarelui (Directional)
     vec3 dirLight = computeDirLight(normalEye, viewDir, texDiffuse, texSpecular, shadow);
 
-    // Lumina Lanternei (Point Light)
-    vec3 lanternLight = computeCustomPointLight(pointLightPos, pointLightColor, normalEye, viewDir, texDiffuse, texSpecular);
-
-    // Lumina Focului (Point Light)
-    vec3 fireLight = computeCustomPointLight(campfirePos, campfireColor, normalEye, viewDir, texDiffuse, texSpecular);
+    // Luminile punctuale (lanterna, focul, ...) din clusterul fragmentului
+    vec3 pointLights = computeClusteredPointLights(normalEye, viewDir, texDiffuse, texSpecular);
 
-    vec3 finalColor = dirLight + lanternLight + fireLight;
+    vec3 finalColor = dirLight + pointLights;
 
     if (enableFog) {
         float fogFactor = computeFog();
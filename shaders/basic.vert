@@ -7,23 +7,29 @@ layout(location = 2) in vec2 vTexCoords;
 out vec3 fPosition;
 out vec3 fNormal;
 out vec2 fTexCoords;
-out vec4 fragPosLightSpace;
+out vec3 fPositionWorld;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
-uniform mat3 normalMatrix;
-uniform mat4 lightSpaceTrMatrix;
+
+// matricele obiectului desenat, scrise pe CPU in stream buffer (DrawUniforms din main.cpp)
+layout(std140) uniform DrawData {
+    mat4 model;
+    mat4 normalMatrix;
+};
+
+// trebuie sa dea exact aceeasi adancime ca depthPrepass.vert
+invariant gl_Position;
 
 void main()
 {
     vec4 posEye = view * model * vec4(vPosition, 1.0);
 
     fPosition = posEye.xyz;
-    fNormal   = normalize(normalMatrix * vNormal);
+    fNormal   = normalize(mat3(normalMatrix) * vNormal);
     fTexCoords = vTexCoords;
 
-    fragPosLightSpace = lightSpaceTrMatrix * model * vec4(vPosition, 1.0f);
+    fPositionWorld = vec3(model * vec4(vPosition, 1.0f));
 
     gl_Position = projection * posEye;
 }
@@ -0,0 +1,136 @@
+#version 410 core
+
+out vec4 fColor;
+
+// --- G-buffer ---
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gDepth;
+uniform mat4 inverseProjection;
+uniform mat4 inverseView;
+
+// --- Lighting ---
+uniform vec3 lightDir; // Soare
+uniform vec3 lightColor;
+uniform bool sunEnabled;
+uniform bool enableFog;
+
+// --- Shadow cascades ---
+const int MAX_CASCADES = 4;
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 lightSpaceTrMatrices[MAX_CASCADES];
+uniform float cascadeSplits[MAX_CASCADES];
+uniform int cascadeCount;
+
+float specularStrength = 0.5;
+float shininess = 32.0;
+
+#if !defined(PCF_TAPS) && !defined(PCF_POISSON)
+#define PCF_TAPS 4
+#endif
+
+#ifdef PCF_POISSON
+const int POISSON_TAPS = 12;
+const vec2 poissonDisk[POISSON_TAPS] = vec2[](
+    vec2(-0.326, -0.406), vec2(-0.840, -0.074), vec2(-0.696,  0.457),
+    vec2(-0.203,  0.621), vec2( 0.962, -0.195), vec2( 0.473, -0.480),
+    vec2( 0.519,  0.767), vec2( 0.185, -0.893), vec2( 0.507,  0.064),
+    vec2( 0.896,  0.412), vec2(-0.322, -0.933), vec2(-0.792, -0.598)
+);
+#endif
+
+vec3 reconstructPosition(vec2 uv, float depth)
+{
+    vec4 ndc = vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec4 position = inverseProjection * ndc;
+    return position.xyz / position.w;
+}
+
+float computeShadow(vec3 positionEye, vec3 normalEye)
+{
+    float viewDepth = -positionEye.z;
+    int cascade = cascadeCount - 1;
+    for (int i = 0; i < cascadeCount - 1; ++i) {
+        if (viewDepth < cascadeSplits[i]) { cascade = i; break; }
+    }
+
+    vec4 fragPosLightSpace = lightSpaceTrMatrices[cascade] * inverseView * vec4(positionEye, 1.0);
+    vec3 normalizedCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    normalizedCoords = normalizedCoords * 0.5 + 0.5;
+    if (normalizedCoords.z > 1.0) return 0.0;
+
+    float bias = max(0.005 * (1.0 - dot(normalEye, normalize(lightDir))), 0.0005);
+    vec4 coords = vec4(normalizedCoords.xy, float(cascade), normalizedCoords.z - bias);
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+
+#if defined(PCF_POISSON)
+    for (int i = 0; i < POISSON_TAPS; ++i) {
+        lit += texture(shadowMap, coords + vec4(poissonDisk[i] * 1.5 * texelSize, 0.0, 0.0));
+    }
+    lit /= float(POISSON_TAPS);
+#elif PCF_TAPS == 1
+    lit = texture(shadowMap, coords);
+#elif PCF_TAPS == 4
+    for (int x = 0; x < 2; ++x) {
+        for (int y = 0; y < 2; ++y) {
+            lit += texture(shadowMap, coords + vec4((vec2(x, y) - 0.5) * texelSize, 0.0, 0.0));
+        }
+    }
+    lit /= 4.0;
+#elif PCF_TAPS == 9
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            lit += texture(shadowMap, coords + vec4(vec2(x, y) * texelSize, 0.0, 0.0));
+        }
+    }
+    lit /= 9.0;
+#else
+    for (int x = 0; x < 4; ++x) {
+        for (int y = 0; y < 4; ++y) {
+            lit += texture(shadowMap, coords + vec4((vec2(x, y) - 1.5) * texelSize, 0.0, 0.0));
+        }
+    }
+    lit /= 16.0;
+#endif
+
+    return 1.0 - lit;
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    // fundal - ramane pentru skybox
+    if (depth >= 1.0) discard;
+
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(gDepth, 0));
+    vec3 positionEye = reconstructPosition(uv, depth);
+    vec3 normalEye = normalize(texelFetch(gNormal, pixel, 0).xyz);
+    vec3 diffTex = texelFetch(gAlbedo, pixel, 0).rgb;
+    vec3 specTex = texelFetch(gSpecular, pixel, 0).rgb;
+    vec3 viewDir = normalize(-positionEye);
+
+    vec3 color = 0.05 * diffTex;
+    if (sunEnabled) {
+        float shadow = computeShadow(positionEye, normalEye);
+        vec3 lightDirN = normalize(lightDir);
+        vec3 diffuse = max(dot(normalEye, lightDirN), 0.0) * lightColor * diffTex;
+        vec3 reflectDir = reflect(-lightDirN, normalEye);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+        vec3 specular = specularStrength * spec * lightColor * specTex;
+        color += (1.0 - shadow) * (diffuse + specular);
+    }
+
+    // ceata se aplica o singura data pe pixel; luminile punctuale se aduna peste, inmultite cu fogFactor
+    if (enableFog) {
+        float fogFactor = clamp(exp(-pow(length(positionEye) * 0.03, 2.0)), 0.0, 1.0);
+        fColor = mix(vec4(0.3, 0.3, 0.3, 1.0), vec4(color, 1.0), fogFactor);
+    } else {
+        fColor = vec4(color, 1.0);
+    }
+
+    // adancimea din G-buffer, pentru skybox si ninsoare
+    gl_FragDepth = depth;
+}
@@ -0,0 +1,59 @@
+#version 410 core
+
+out vec4 fColor;
+
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gDepth;
+uniform mat4 inverseProjection;
+
+uniform vec3 lightPosition; // eye space
+uniform vec3 lightColor;
+uniform float lightRadius;
+uniform bool enableFog;
+
+float specularStrength = 0.5;
+float shininess = 32.0;
+
+float constant = 1.0f;
+float linear = 0.7f;
+float quadratic = 1.8f;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth >= 1.0) discard;
+
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(gDepth, 0));
+    vec4 ndc = vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec4 position = inverseProjection * ndc;
+    vec3 positionEye = position.xyz / position.w;
+
+    float distance = length(lightPosition - positionEye);
+    if (distance > lightRadius) discard;
+
+    vec3 normalEye = normalize(texelFetch(gNormal, pixel, 0).xyz);
+    vec3 diffTex = texelFetch(gAlbedo, pixel, 0).rgb;
+    vec3 specTex = texelFetch(gSpecular, pixel, 0).rgb;
+    vec3 viewDir = normalize(-positionEye);
+
+    vec3 lightDir = normalize(lightPosition - positionEye);
+    float attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance));
+    float window = clamp(1.0 - pow(distance / lightRadius, 4.0), 0.0, 1.0);
+    attenuation *= window * window;
+
+    float diff = max(dot(normalEye, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, normalEye);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+
+    vec3 color = (0.05 * lightColor * diffTex + diff * lightColor * diffTex + specularStrength * spec * lightColor * specTex) * attenuation;
+
+    // mix(fog, a + b, f) = mix(fog, a, f) + f * b
+    if (enableFog) {
+        color *= clamp(exp(-pow(length(positionEye) * 0.03, 2.0)), 0.0, 1.0);
+    }
+
+    fColor = vec4(color, 1.0);
+}
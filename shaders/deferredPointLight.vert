@@ -0,0 +1,14 @@
+#version 410 core
+
+layout(location = 0) in vec3 vPosition;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 lightPositionWorld;
+uniform float lightRadius;
+
+void main()
+{
+    // sfera unitate scalata la raza luminii
+    gl_Position = projection * view * vec4(lightPositionWorld + vPosition * lightRadius, 1.0);
+}
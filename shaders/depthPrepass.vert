@@ -0,0 +1,21 @@
+#version 410 core
+
+layout(location = 0) in vec3 vPosition;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// acelasi bloc ca in basic.vert
+layout(std140) uniform DrawData {
+    mat4 model;
+    mat4 normalMatrix;
+};
+
+// aceeasi formula ca basic.vert - pasul principal foloseste GL_EQUAL pe adancime
+invariant gl_Position;
+
+void main()
+{
+    vec4 posEye = view * model * vec4(vPosition, 1.0);
+    gl_Position = projection * posEye;
+}
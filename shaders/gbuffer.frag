@@ -0,0 +1,21 @@
+#version 410 core
+
+in vec3 fPosition;
+in vec3 fNormal;
+in vec2 fTexCoords;
+in vec3 fPositionWorld;
+
+// G-buffer (pozitia se reconstruieste din adancime in pasul de iluminare)
+layout(location = 0) out vec4 gNormal;
+layout(location = 1) out vec4 gAlbedo;
+layout(location = 2) out vec4 gSpecular;
+
+uniform sampler2D diffuseTexture;
+uniform sampler2D specularTexture;
+
+void main()
+{
+    gNormal = vec4(normalize(fNormal), 0.0);
+    gAlbedo = vec4(texture(diffuseTexture, fTexCoords).rgb, 1.0);
+    gSpecular = vec4(texture(specularTexture, fTexCoords).rgb, 1.0);
+}
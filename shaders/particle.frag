@@ -0,0 +1,16 @@
+#version 410 core
+
+in vec2 fCorner;
+in vec4 fColor;
+
+out vec4 fragColor;
+
+void main()
+{
+    float r2 = dot(fCorner, fCorner);
+    if (r2 > 1.0)
+        discard;
+
+    // culoare premultiplicata; alpha 0 inseamna aditiv (scantei), altfel fum amestecat normal
+    fragColor = fColor * (1.0 - r2);
+}
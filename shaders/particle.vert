@@ -0,0 +1,23 @@
+#version 410 core
+
+// o particula pe instanta (ParticleInstance din ParticleSystem.hpp), desenata ca un patrat
+// orientat spre camera
+layout(location = 0) in vec4 vPositionSize;
+layout(location = 1) in vec4 vColor;
+
+out vec2 fCorner;
+out vec4 fColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    vec4 positionEye = view * vec4(vPositionSize.xyz, 1.0);
+
+    fCorner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    positionEye.xy += fCorner * vPositionSize.w * 0.5;
+    gl_Position = projection * positionEye;
+
+    fColor = vColor;
+}
@@ -1,13 +1,19 @@
 #version 410 core
 
+in vec2 fCorner;
+in float fFade;
+
 out vec4 fColor;
 
 void main()
 {
     // Create circular snowflakes
-    vec2 coord = gl_PointCoord - vec2(0.5);
-    if (length(coord) > 0.5)
+    float r = length(fCorner);
+    if (r > 1.0)
         discard;
-    
-    fColor = vec4(1.0, 1.0, 1.0, 0.9); // White with slight transparency
-}
\ No newline at end of file
+
+    // White with slight transparency, soft edge, fading into the fog; premultiplied alpha,
+    // so the same blending works on the screen and in the low resolution target
+    float alpha = 0.9 * smoothstep(1.0, 0.7, r) * fFade;
+    fColor = vec4(vec3(alpha), alpha);
+}
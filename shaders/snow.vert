@@ -1,13 +1,78 @@
 #version 410 core
 
+// un fulg pe instanta, desenat ca un patrat (triangle strip de 4 varfuri) orientat spre camera
 layout(location = 0) in vec3 vPosition;
+layout(location = 1) in float vSize;
+
+out vec2 fCorner;
+out float fFade;
 
 uniform mat4 view;
 uniform mat4 projection;
-uniform float pointSize;
+// inaltimea viewport-ului in pixeli, pentru limitele de marime pe ecran
+uniform float viewportHeight;
+// raza unui fulg de marime 1, in metri
+uniform float flakeRadius;
+// marimea pe ecran e tinuta intre aceste limite (raza in pixeli)
+uniform float minPixelRadius;
+uniform float maxPixelRadius;
+// de la thinStart la maxDistance densitatea scade liniar pana la thinKeep
+uniform float thinStart;
+uniform float maxDistance;
+uniform float thinKeep;
+uniform bool enableFog;
+
+float hash(uint v)
+{
+    v = v * 747796405u + 2891336453u;
+    v = ((v >> ((v >> 28u) + 4u)) ^ v) * 277803737u;
+    return float((v >> 22u) ^ v) * (1.0 / 4294967295.0);
+}
+
+void cull()
+{
+    // in afara volumului de decupare, triunghiurile sunt aruncate inainte de rasterizare
+    gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+    fCorner = vec2(0.0);
+    fFade = 0.0;
+}
 
 void main()
 {
-    gl_Position = projection * view * vec4(vPosition, 1.0);
-    gl_PointSize = pointSize;
-}
\ No newline at end of file
+    vec4 positionEye = view * vec4(vPosition, 1.0);
+    float dist = -positionEye.z;
+
+    float fogFactor = enableFog ? exp(-pow(dist * 0.03, 2.0)) : 1.0;
+
+    // fulgii prea departe, ascunsi complet de ceata sau in spatele camerei nu se deseneaza
+    if (dist <= 0.0 || dist > maxDistance || fogFactor < 0.02) {
+        cull();
+        return;
+    }
+
+    // rarire cu distanta: fiecare fulg are un prag fix, deci nu clipeste de la un cadru la altul
+    float keep = mix(1.0, thinKeep, clamp((dist - thinStart) / (maxDistance - thinStart), 0.0, 1.0));
+    if (hash(uint(gl_InstanceID)) > keep) {
+        cull();
+        return;
+    }
+
+    // raza in pixeli limitata: aproape de camera nu acopera jumatate de ecran, departe nu dispare
+    float pixelsPerMeter = projection[1][1] * 0.5 * viewportHeight / dist;
+    float pixelRadius = clamp(vSize * flakeRadius * pixelsPerMeter, minPixelRadius, maxPixelRadius);
+    float radius = pixelRadius / pixelsPerMeter;
+
+    // centrul in afara frustum-ului (cu marginea razei) - tot fulgul e in afara
+    vec4 center = projection * positionEye;
+    float margin = radius * max(projection[0][0], projection[1][1]);
+    if (any(greaterThan(abs(center.xy), vec2(center.w + margin)))) {
+        cull();
+        return;
+    }
+
+    fCorner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    positionEye.xy += fCorner * radius;
+    gl_Position = projection * positionEye;
+
+    fFade = fogFactor;
+}
@@ -0,0 +1,57 @@
+#version 410 core
+
+// fulgii de la rezolutie redusa, adusi pe ecran: interpolare biliniara unde cei 4 texeli vecini au
+// aproximativ adancimea pixelului, altfel culoarea texelului cu adancimea cea mai apropiata
+uniform sampler2D snowColor;
+uniform sampler2D snowDepth;
+uniform sampler2D sceneDepth;
+uniform int scale;
+uniform float cameraNear;
+uniform float cameraFar;
+
+out vec4 fColor;
+
+// diferenta relativa de adancime peste care texelii sunt considerati pe alta suprafata
+const float DEPTH_THRESHOLD = 0.1;
+
+float linearDepth(float depth)
+{
+    float z = depth * 2.0 - 1.0;
+    return 2.0 * cameraNear * cameraFar / (cameraFar + cameraNear - z * (cameraFar - cameraNear));
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = linearDepth(texelFetch(sceneDepth, pixel, 0).r);
+
+    // centrul pixelului in coordonate de texel la rezolutie redusa
+    vec2 position = (vec2(pixel) + 0.5) / float(scale) - 0.5;
+    ivec2 base = ivec2(floor(position));
+    vec2 f = position - vec2(base);
+    ivec2 maxTexel = textureSize(snowColor, 0) - 1;
+
+    ivec2 offsets[4] = ivec2[](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(1, 1));
+    float weights[4] = float[]((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+
+    vec4 bilinear = vec4(0.0);
+    vec4 nearest = vec4(0.0);
+    float nearestDifference = 1e30;
+    bool edge = false;
+
+    for (int i = 0; i < 4; i++) {
+        ivec2 texel = clamp(base + offsets[i], ivec2(0), maxTexel);
+        vec4 color = texelFetch(snowColor, texel, 0);
+        float difference = abs(linearDepth(texelFetch(snowDepth, texel, 0).r) - depth);
+
+        bilinear += color * weights[i];
+        if (difference < nearestDifference) {
+            nearestDifference = difference;
+            nearest = color;
+        }
+        edge = edge || difference > DEPTH_THRESHOLD * depth;
+    }
+
+    // culoare premultiplicata cu alpha, amestecata cu GL_ONE, GL_ONE_MINUS_SRC_ALPHA
+    fColor = edge ? nearest : bilinear;
+}
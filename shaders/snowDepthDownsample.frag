@@ -0,0 +1,21 @@
+#version 410 core
+
+// adancimea scenei la rezolutia fulgilor: cea mai departata valoare din fiecare bloc scale x scale,
+// ca fulgii din spatele marginilor obiectelor sa nu dispara (compozitia rezolva marginile)
+uniform sampler2D sceneDepth;
+uniform int scale;
+
+void main()
+{
+    ivec2 base = ivec2(gl_FragCoord.xy) * scale;
+    ivec2 maxTexel = textureSize(sceneDepth, 0) - 1;
+
+    float depth = 0.0;
+    for (int y = 0; y < scale; y++) {
+        for (int x = 0; x < scale; x++) {
+            depth = max(depth, texelFetch(sceneDepth, min(base + ivec2(x, y), maxTexel), 0).r);
+        }
+    }
+
+    gl_FragDepth = depth;
+}
@@ -0,0 +1,81 @@
+#version 410 core
+
+// un fulg de nea - acelasi layout ca GpuSnowParticle din GpuSnow.hpp
+layout(location = 0) in vec3 vPosition;
+layout(location = 1) in vec3 vVelocity;
+layout(location = 2) in float vSize;
+layout(location = 3) in float vLifetime;
+
+// capturate cu transform feedback in celalalt buffer
+out vec3 tfPosition;
+out vec3 tfVelocity;
+out float tfSize;
+out float tfLifetime;
+
+uniform float deltaTime;
+uniform uint seed;
+// primul cadru: fulgii sunt imprastiati in tot volumul
+uniform bool initialize;
+// volumul care urmareste camera - fulgii care ies pe o parte intra pe partea opusa
+uniform vec3 volumeMin;
+uniform vec3 volumeSize;
+// inaltimea suprafetelor statice (Heightfield), vazute de sus
+uniform sampler2D heightfield;
+uniform vec2 heightfieldMin;
+uniform vec2 heightfieldSize;
+uniform float heightfieldFloor;
+
+// hash PCG - un numar aleator independent pentru fiecare fulg si fiecare cadru
+uint pcgHash(uint v)
+{
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float random(inout uint state)
+{
+    state = pcgHash(state);
+    return float(state) * (1.0 / 4294967295.0);
+}
+
+void main()
+{
+    vec3 velocity = vVelocity;
+    float size = vSize;
+    float lifetime = vLifetime + deltaTime;
+
+    // impachetare toroidala: pozitia relativa la volum, adusa inapoi in [0, volumeSize)
+    vec3 local = vPosition + vVelocity * deltaTime - volumeMin;
+    bool fell = local.y < 0.0;
+    local -= volumeSize * floor(local / volumeSize);
+    vec3 position = volumeMin + local;
+
+    // fulgii care ating solul sau un acoperis o iau de la capat, sus
+    vec2 uv = (position.xz - heightfieldMin) / heightfieldSize;
+    bool onField = all(greaterThanEqual(uv, vec2(0.0))) && all(lessThanEqual(uv, vec2(1.0)));
+    float surface = onField ? textureLod(heightfield, uv, 0.0).r : heightfieldFloor;
+    bool landed = !fell && position.y < surface;
+    if (landed) {
+        position.y = volumeMin.y + volumeSize.y;
+    }
+
+    if (initialize || fell || landed) {
+        uint state = pcgHash(uint(gl_VertexID) ^ pcgHash(seed));
+
+        // alta coloana, ca fulgii sa nu cada mereu pe aceleasi linii
+        position.xz = volumeMin.xz + vec2(random(state), random(state)) * volumeSize.xz;
+        if (initialize) {
+            position.y = volumeMin.y + random(state) * volumeSize.y;
+            velocity.xz = vec2(random(state), random(state)) * 0.4 - 0.2;
+            size = random(state) * 0.8 + 0.8;
+        }
+        velocity.y = -(random(state) + 0.4);
+        lifetime = 0.0;
+    }
+
+    tfPosition = position;
+    tfVelocity = velocity;
+    tfSize = size;
+    tfLifetime = lifetime;
+}